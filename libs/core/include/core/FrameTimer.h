@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <chrono>
+#include <thread>
+#include <vector>
 
 class FrameTimer {
 public:
@@ -43,3 +45,77 @@ private:
     double m_frameTime{};
     double m_fps{};
 };
+
+// Keeps the most recent frame times to report percentiles of, which show hitches that averages
+// like FPS hide
+class FrameTimeStats {
+public:
+    FrameTimeStats(size_t maxFrames = 600) {
+        m_frameTimes.reserve(maxFrames);
+        m_sorted.reserve(maxFrames);
+        m_maxFrames = maxFrames;
+    }
+
+    void AddFrameTime(double frameTime) {
+        if (m_frameTimes.size() < m_maxFrames) {
+            m_frameTimes.push_back(frameTime);
+        } else {
+            m_frameTimes[m_next] = frameTime;
+        }
+        m_next = (m_next + 1) % m_maxFrames;
+    }
+
+    size_t NumFrames() const { return m_frameTimes.size(); }
+
+    // Returns the frame time that the given percentage (in [0, 100]) of recent frames are at most,
+    // or 0 if there are none
+    double Percentile(double percent) const {
+        if (m_frameTimes.empty())
+            return 0;
+        m_sorted = m_frameTimes;
+        const auto rank = static_cast<size_t>(percent / 100 * (m_sorted.size() - 1) + 0.5);
+        std::nth_element(m_sorted.begin(), m_sorted.begin() + rank, m_sorted.end());
+        return m_sorted[rank];
+    }
+
+private:
+    std::vector<double> m_frameTimes; // Ring buffer
+    size_t m_maxFrames{};
+    size_t m_next{};
+    mutable std::vector<double> m_sorted;
+};
+
+// Waits for frames to be presented at precise intervals, e.g. at the emulated machine's own frame
+// rate rather than the host's. Sleeps are only precise to a millisecond or more, so waits sleep
+// for most of the time, then spin for the rest.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Waits until frameDuration seconds after the previous frame. If that's already passed by more
+    // than a frame, e.g. after a hitch, doesn't wait, and restarts pacing from now rather than
+    // rushing frames to catch up.
+    void WaitForNextFrame(double frameDuration) {
+        const auto duration = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(frameDuration));
+        const auto now = Clock::now();
+        m_frameTime += duration;
+        if (m_frameTime + duration < now) {
+            m_frameTime = now;
+            return;
+        }
+
+        if (m_frameTime - now > SpinTime)
+            std::this_thread::sleep_until(m_frameTime - SpinTime);
+        while (Clock::now() < m_frameTime)
+            std::this_thread::yield();
+    }
+
+    // The next wait doesn't wait
+    void Reset() { m_frameTime = {}; }
+
+private:
+    static constexpr auto SpinTime = std::chrono::milliseconds(2);
+
+    Clock::time_point m_frameTime{}; // When the last frame was due
+};
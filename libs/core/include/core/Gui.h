@@ -9,6 +9,7 @@
 
 #include <array>
 #include <imgui.h>
+#include <thread>
 
 namespace Gui {
     namespace Window {
@@ -17,10 +18,14 @@ namespace Gui {
 
     inline std::array<bool, Window::Size> EnabledWindows = {};
 
+    // ImGui may only be used from the thread that renders it, which is the main thread. Calls made
+    // from other threads, like the engine's emulation thread, are skipped.
+    inline const std::thread::id ThreadId = std::this_thread::get_id();
+
     namespace Internal {
         template <typename Func>
         void DoImguiCall(const char* name, Window::Type type, Func func) {
-            if (Gui::EnabledWindows[type]) {
+            if (Gui::EnabledWindows[type] && std::this_thread::get_id() == Gui::ThreadId) {
                 if (strcmp(name, "Debug") == 0)
                     name = "Debug Options"; // Don't collide with ImGui's internal window
                 bool open = true;
@@ -11,4 +11,8 @@ namespace ImageUtil {
     };
     std::optional<PngImageData> loadPngImage(const char* name);
 
+    // Rows of data are top to bottom
+    bool savePngImage(const char* name, int width, int height, int numChannels,
+                      const uint8_t* data);
+
 } // namespace ImageUtil
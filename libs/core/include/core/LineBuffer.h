@@ -0,0 +1,186 @@
+#pragma once
+
+#include "core/Line.h"
+#include <cassert>
+#include <initializer_list>
+#include <vector>
+
+// Lines to draw in a frame (see RenderContext). Storage is kept when cleared, so that once it has
+// grown to fit the busiest frame, adding lines doesn't allocate. Lines added beyond MaxLines() are
+// dropped, so that frames that accumulate lines, e.g. while the renderer is behind, can't grow it
+// without bound.
+//
+// Lines are stored as an array of Line by default. With Layout::Arrays, each coordinate and the
+// brightness are stored in separate arrays instead, so that SIMD consumers can load them directly.
+class LineBuffer {
+public:
+    enum class Layout { Lines, Arrays };
+
+    // Layout::Arrays storage, Size() elements each
+    struct Arrays {
+        const float* x0;
+        const float* y0;
+        const float* x1;
+        const float* y1;
+        const float* brightness;
+    };
+
+    LineBuffer() = default;
+    LineBuffer(std::initializer_list<Line> lines) {
+        for (auto& line : lines)
+            PushBack(line);
+    }
+
+    // Keeps the lines in the buffer
+    void SetLayout(Layout layout) {
+        if (layout == m_layout)
+            return;
+
+        std::vector<Line> lines;
+        lines.reserve(Size());
+        for (size_t i = 0; i < Size(); ++i)
+            lines.push_back(Get(i));
+
+        const size_t capacity = Capacity();
+        ClearStorage();
+        m_layout = layout;
+        Reserve(capacity);
+        for (auto& line : lines)
+            Append(line);
+    }
+    Layout GetLayout() const { return m_layout; }
+
+    // 0 means no limit, the default
+    void SetMaxLines(size_t maxLines) { m_maxLines = maxLines; }
+    size_t MaxLines() const { return m_maxLines; }
+
+    // Number of lines dropped since the last Clear because MaxLines() was reached. Once a line is
+    // dropped, all lines are until the next Clear, so that the last line is never extended by
+    // lines that were dropped.
+    size_t NumDropped() const { return m_numDropped; }
+
+    void Reserve(size_t numLines) {
+        if (m_layout == Layout::Lines) {
+            m_lines.reserve(numLines);
+        } else {
+            for (auto* array : {&m_x0, &m_y0, &m_x1, &m_y1, &m_brightness})
+                array->reserve(numLines);
+        }
+    }
+
+    // Number of lines that can be stored without allocating
+    size_t Capacity() const {
+        return m_layout == Layout::Lines ? m_lines.capacity() : m_x0.capacity();
+    }
+
+    size_t Size() const { return m_layout == Layout::Lines ? m_lines.size() : m_x0.size(); }
+    bool Empty() const { return Size() == 0; }
+
+    // Removes all lines, keeping storage
+    void Clear() {
+        ClearStorage();
+        m_numDropped = 0;
+    }
+
+    void PushBack(const Line& line) {
+        if (m_numDropped > 0 || (m_maxLines > 0 && Size() >= m_maxLines)) {
+            ++m_numDropped;
+            return;
+        }
+        Append(line);
+    }
+
+    void PopBack() {
+        assert(!Empty());
+        if (m_layout == Layout::Lines) {
+            m_lines.pop_back();
+        } else {
+            for (auto* array : {&m_x0, &m_y0, &m_x1, &m_y1, &m_brightness})
+                array->pop_back();
+        }
+    }
+
+    Line Get(size_t index) const {
+        assert(index < Size());
+        if (m_layout == Layout::Lines)
+            return m_lines[index];
+        return {{m_x0[index], m_y0[index]}, {m_x1[index], m_y1[index]}, m_brightness[index]};
+    }
+
+    void Set(size_t index, const Line& line) {
+        assert(index < Size());
+        if (m_layout == Layout::Lines) {
+            m_lines[index] = line;
+        } else {
+            m_x0[index] = line.p0.x;
+            m_y0[index] = line.p0.y;
+            m_x1[index] = line.p1.x;
+            m_y1[index] = line.p1.y;
+            m_brightness[index] = line.brightness;
+        }
+    }
+
+    Line Back() const { return Get(Size() - 1); }
+
+    // Moves the end of the last line, unless lines are being dropped
+    void SetBackEnd(const Vector2& p1) {
+        assert(!Empty());
+        if (m_numDropped > 0)
+            return;
+        if (m_layout == Layout::Lines) {
+            m_lines.back().p1 = p1;
+        } else {
+            m_x1.back() = p1.x;
+            m_y1.back() = p1.y;
+        }
+    }
+
+    // Calls func(const Line&) for each line, in order
+    template <typename Func>
+    void ForEach(Func func) const {
+        if (m_layout == Layout::Lines) {
+            for (auto& line : m_lines)
+                func(line);
+        } else {
+            for (size_t i = 0; i < m_x0.size(); ++i)
+                func(Line{{m_x0[i], m_y0[i]}, {m_x1[i], m_y1[i]}, m_brightness[i]});
+        }
+    }
+
+    // Layout::Lines storage, Size() elements
+    const Line* GetLines() const {
+        assert(m_layout == Layout::Lines);
+        return m_lines.data();
+    }
+
+    Arrays GetArrays() const {
+        assert(m_layout == Layout::Arrays);
+        return {m_x0.data(), m_y0.data(), m_x1.data(), m_y1.data(), m_brightness.data()};
+    }
+
+private:
+    void Append(const Line& line) {
+        if (m_layout == Layout::Lines) {
+            m_lines.push_back(line);
+        } else {
+            m_x0.push_back(line.p0.x);
+            m_y0.push_back(line.p0.y);
+            m_x1.push_back(line.p1.x);
+            m_y1.push_back(line.p1.y);
+            m_brightness.push_back(line.brightness);
+        }
+    }
+
+    void ClearStorage() {
+        m_lines.clear();
+        for (auto* array : {&m_x0, &m_y0, &m_x1, &m_y1, &m_brightness})
+            array->clear();
+    }
+
+    Layout m_layout = Layout::Lines;
+    size_t m_maxLines = 0;
+    size_t m_numDropped = 0;
+
+    std::vector<Line> m_lines; // Layout::Lines
+    std::vector<float> m_x0, m_y0, m_x1, m_y1, m_brightness; // Layout::Arrays
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// Lock-free, fixed-size ring buffer with a single producer thread and a single consumer thread.
+// Values are pushed and popped in bulk; pushes that don't fit are truncated rather than waiting for
+// the consumer.
+template <typename T>
+class SpscRingBuffer {
+public:
+    SpscRingBuffer(size_t maxSize = 0) { Init(maxSize); }
+
+    // Not thread-safe: must be called before the producer and consumer start
+    void Init(size_t maxSize) {
+        // One slot is left unused so that a full buffer can be told apart from an empty one
+        m_buffer.resize(maxSize + 1);
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
+
+    // Total number of elements that can be added to the buffer
+    size_t TotalSize() const { return m_buffer.size() - 1; }
+
+    // Number of elements in the buffer. Exact only when called from the producer or the consumer,
+    // as the other side may be pushing or popping concurrently.
+    size_t UsedSize() const {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : tail + m_buffer.size() - head;
+    }
+
+    // Producer: pushes up to numValues from source. Returns number of values actually pushed.
+    size_t Push(const T* source, size_t numValues) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t freeSize =
+            (head > tail ? head - tail : head + m_buffer.size() - tail) - 1;
+        numValues = std::min(numValues, freeSize);
+
+        const size_t firstSize = std::min(numValues, m_buffer.size() - tail);
+        std::copy_n(source, firstSize, m_buffer.begin() + tail);
+        std::copy_n(source + firstSize, numValues - firstSize, m_buffer.begin());
+
+        m_tail.store((tail + numValues) % m_buffer.size(), std::memory_order_release);
+        return numValues;
+    }
+
+    // Consumer: pops up to numValues into dest. Returns number of values actually popped.
+    size_t Pop(T* dest, size_t numValues) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        const size_t usedSize = tail >= head ? tail - head : tail + m_buffer.size() - head;
+        numValues = std::min(numValues, usedSize);
+
+        const size_t firstSize = std::min(numValues, m_buffer.size() - head);
+        std::copy_n(m_buffer.begin() + head, firstSize, dest);
+        std::copy_n(m_buffer.begin(), numValues - firstSize, dest + firstSize);
+
+        m_head.store((head + numValues) % m_buffer.size(), std::memory_order_release);
+        return numValues;
+    }
+
+private:
+    std::vector<T> m_buffer;
+    std::atomic<size_t> m_head{}; // Next value to pop, only written by the consumer
+    std::atomic<size_t> m_tail{}; // Next slot to push to, only written by the producer
+};
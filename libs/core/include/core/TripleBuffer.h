@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for handing off the latest value from one writer thread to one reader
+// thread. The writer fills WriteBuffer() and publishes it, and the reader takes the most recently
+// published value, if any, into ReadBuffer(). Neither side ever waits on the other; if the writer
+// publishes more than once before the reader consumes, only the latest value is seen.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer
+
+    T& WriteBuffer() { return m_buffers[m_write]; }
+
+    // Makes the write buffer the latest value, and takes over the previous middle buffer as the
+    // new write buffer. The new write buffer holds whatever value it was last left with.
+    void Publish() {
+        m_write = m_middle.exchange(m_write | NewBit, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // Returns true if the reader has consumed the last published value
+    bool Consumed() const { return (m_middle.load(std::memory_order_acquire) & NewBit) == 0; }
+
+    // Reader
+
+    // If a value was published since the last call, makes it the read buffer and returns true.
+    // Otherwise, the read buffer keeps its current value and false is returned.
+    bool Consume() {
+        if (Consumed())
+            return false;
+        m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+
+    T& ReadBuffer() { return m_buffers[m_read]; }
+    const T& ReadBuffer() const { return m_buffers[m_read]; }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t NewBit = 0x4;
+
+    std::array<T, 3> m_buffers{};
+    uint8_t m_write = 0;
+    uint8_t m_read = 1;
+    std::atomic<uint8_t> m_middle{2}; // Index of the middle buffer, with NewBit if unconsumed
+};
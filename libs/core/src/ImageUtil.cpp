@@ -8,6 +8,8 @@ MSC_PUSH_WARNING_DISABLE(4100  // unreferenced formal parameter
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_ONLY_PNG
 #include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 MSC_POP_WARNING_DISABLE()
 
 namespace ImageUtil {
@@ -16,6 +18,8 @@ namespace ImageUtil {
         stbi_set_flip_vertically_on_load(1);
         int width{}, height{}, numChannels{};
         auto buffer = stbi_load(name, &width, &height, &numChannels, 0);
+        if (!buffer)
+            return {};
 
         size_t size = width * height * numChannels;
         auto data = std::make_unique<unsigned char[]>(size);
@@ -26,4 +30,9 @@ namespace ImageUtil {
         return PngImageData{width, height, numChannels == 4, std::move(data)};
     }
 
+    bool savePngImage(const char* name, int width, int height, int numChannels,
+                      const uint8_t* data) {
+        return stbi_write_png(name, width, height, numChannels, data, width * numChannels) != 0;
+    }
+
 } // namespace ImageUtil
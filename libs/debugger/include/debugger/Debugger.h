@@ -7,6 +7,9 @@
 #include "debugger/SyncProtocol.h"
 #include "debugger/Trace.h"
 #include "emulator/EngineTypes.h"
+#include "emulator/Movie.h"
+#include "emulator/RewindBuffer.h"
+#include <bitset>
 #include <map>
 #include <optional>
 #include <queue>
@@ -24,9 +27,13 @@ public:
     void Init(const std::vector<std::string_view>& args,
               std::shared_ptr<IEngineService>& engineService, fs::path devDir, Emulator& emulator);
     void Reset();
+    void Shutdown();
     bool FrameUpdate(double frameTime, const EmuEvents& emuEvents, const Input& input,
                      RenderContext& renderContext, AudioContext& audioContext);
 
+    // Number of frames to run ahead of the presented one (0 to disable). See RunAhead.
+    void SetRunAheadFrames(int frames) { m_runAheadFrames = frames; }
+
     using SymbolTable = std::multimap<uint16_t, std::string>;
 
 private:
@@ -37,11 +44,20 @@ private:
     void PrintCallStack();
     void CheckForBreakpoints();
     void PostOpUpdateCallstack(const CpuRegisters& preOpRegisters);
-    void ExecuteFrameInstructions(double frameTime, const Input& input,
-                                  RenderContext& renderContext, AudioContext& audioContext);
+    double ExecuteFrameInstructions(double frameTime, const Input& input,
+                                    RenderContext& renderContext, AudioContext& audioContext);
     cycles_t ExecuteInstruction(const Input& input, RenderContext& renderContext,
                                 AudioContext& audioContext);
+    bool CanRunCycles();
+    cycles_t RunCycles(cycles_t cycles, const Input& input, RenderContext& renderContext,
+                       AudioContext& audioContext);
     void SyncInstructionHash(int numInstructionsExecutedThisFrame);
+    void PushRewindState();
+    bool RewindFrames(size_t frames);
+    void RunAhead(double frameTime, const Input& input, RenderContext& renderContext,
+                  AudioContext& audioContext);
+    void UpdateMovie(double& frameTime, Input& input);
+    void EndMoviePlayback();
 
     std::shared_ptr<IEngineService> m_engineService;
     fs::path m_devDir;
@@ -49,12 +65,15 @@ private:
     MemoryBus* m_memoryBus = nullptr;
     Cpu* m_cpu = nullptr;
     bool m_breakIntoDebugger = false;
+    bool m_fastForward = false; // This frame
+    bool m_wholeFrame = false;  // This frame
     bool m_traceEnabled = false;
     bool m_colorEnabled = false;
     std::queue<std::string> m_pendingCommands;
     std::string m_lastCommand;
     Breakpoints m_breakpoints;
     ConditionalBreakpoints m_conditionalBreakpoints;
+    std::bitset<0x10000> m_instructionBreakpoints; // See CanRunCycles
     CallStack m_callStack;
     std::optional<int64_t> m_numInstructionsToExecute = {};
     SymbolTable m_symbolTable; // Address to symbol name
@@ -64,6 +83,18 @@ private:
     uint32_t m_instructionHash = 0;
     SyncProtocol m_syncProtocol;
 
+    RewindBuffer m_rewindBuffer;
+    std::vector<uint8_t> m_rewindState;
+    cycles_t m_rewindStateCycles = 0; // Machine cycles at the last pushed state
+
+    int m_runAheadFrames = 0;
+    std::vector<uint8_t> m_runAheadState;
+
+    enum class MovieMode { None, Record, Play };
+    MovieMode m_movieMode = MovieMode::None;
+    Movie m_movie;
+    std::string m_movieFile;
+
     const size_t MaxTraceInstructions = 1000'000;
     CircularBuffer<Trace::InstructionTraceInfo> m_instructionTraceBuffer{MaxTraceInstructions};
     Trace::InstructionTraceInfo* m_currTraceInfo = nullptr;
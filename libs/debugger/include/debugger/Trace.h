@@ -54,7 +54,7 @@ namespace Trace {
             ++opCodeIndex;
         }
 
-        instruction.cpuOp = &LookupCpuOpRuntime(cpuOpPage, instruction.opBytes[opCodeIndex]);
+        instruction.cpuOp = &LookupCpuOp(cpuOpPage, instruction.opBytes[opCodeIndex]);
         instruction.page = cpuOpPage;
         instruction.firstOperandIndex = opCodeIndex + 1;
         return instruction;
@@ -13,17 +13,28 @@
 #include "emulator/MemoryBus.h"
 #include "emulator/Ram.h"
 #include "emulator/Via.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
+#include <random>
 #include <sstream>
 #include <string>
 #include <vector>
 
 namespace {
+    // Enough for a few minutes of frames
+    const size_t RewindMaxFrames = 5 * 60 * 60;
+    const size_t RewindMemoryBudget = 8 * 1024 * 1024;
+
+    // When fast-forwarding, output is only produced for the last emulated frame (the BIOS refreshes
+    // the screen at 50 Hz)
+    const double FastForwardOutputCycles = Cpu::Hz / 50;
+
     struct ScopedConsoleCtrlHandler {
         template <typename Handler>
         ScopedConsoleCtrlHandler(Handler handler) {
@@ -571,6 +582,7 @@ namespace {
                "  trace                                disassembly trace\n"
                "option ...                           set option\n"
                "  errors {ignore|log|logonce|fail}     error policy\n"
+               "rewind [frames]                      rewind to the start of a previous frame\n"
                "t[race] ...                          display trace output\n"
                "  -n <num_lines>                       display num_lines worth\n"
                "  -f <file_name>                       output trace to file_name\n"
@@ -666,11 +678,29 @@ void Debugger::Init(const std::vector<std::string_view>& args,
     else if (contains(args, "-client"))
         m_syncProtocol.InitClient();
 
+    // Movies start at the next reset
+    auto argIter = std::find_if(args.begin(), args.end(),
+                                [](auto arg) { return arg == "-record" || arg == "-play"; });
+    if (argIter != args.end() && argIter + 1 != args.end()) {
+        m_movieFile = *(argIter + 1);
+        if (*argIter == "-record") {
+            m_movieMode = MovieMode::Record;
+        } else if (m_movie.Load(m_movieFile.c_str())) {
+            m_movieMode = MovieMode::Play;
+        } else {
+            Errorf("Failed to load movie file: %s\n", m_movieFile.c_str());
+        }
+    }
+
     m_devDir = std::move(devDir);
     m_emulator = &emulator;
     m_memoryBus = &emulator.GetMemoryBus();
     m_cpu = &emulator.GetCpu();
 
+    m_rewindState.resize(emulator.StateSize());
+    m_rewindBuffer.Init(m_rewindState.size(), RewindMemoryBudget, RewindMaxFrames);
+    m_runAheadState.resize(emulator.StateSize());
+
     Platform::InitConsole();
 
     Platform::SetConsoleCtrlHandler([this] {
@@ -740,11 +770,45 @@ void Debugger::Reset() {
     m_instructionTraceBuffer.Clear();
     m_currTraceInfo = nullptr;
     m_callStack.Clear();
+    m_rewindBuffer.Clear();
 
     // Force ram to zero when running sync protocol for determinism
     if (!m_syncProtocol.IsStandalone()) {
         m_emulator->GetRam().Zero();
     }
+
+    // Reset again with the movie's ram seed, so that the session can be reproduced
+    if (m_movieMode == MovieMode::Record) {
+        Movie::Header header;
+        header.ramSeed = std::random_device{}();
+        header.biosHash = m_emulator->BiosHash();
+        header.romHash = m_emulator->RomHash();
+        m_movie.BeginRecording(header);
+        m_emulator->Reset(header.ramSeed);
+        m_instructionHash = 0;
+
+    } else if (m_movieMode == MovieMode::Play) {
+        const auto& header = m_movie.GetHeader();
+        if (header.biosHash != m_emulator->BiosHash() || header.romHash != m_emulator->RomHash())
+            Errorf("Warning: movie was recorded with a different BIOS or rom\n");
+        m_movie.BeginPlayback();
+        m_emulator->Reset(header.ramSeed);
+        m_instructionHash = 0;
+    }
+}
+
+void Debugger::Shutdown() {
+    if (m_movieMode != MovieMode::Record)
+        return;
+
+    // The hash only covers traced instructions
+    m_movie.GetHeader().instructionHash = m_traceEnabled ? m_instructionHash : 0;
+    if (m_movie.Save(m_movieFile.c_str())) {
+        Printf("Saved movie of %zu frame(s) to %s (instruction hash $%08x)\n", m_movie.NumFrames(),
+               m_movieFile.c_str(), m_movie.GetHeader().instructionHash);
+    } else {
+        Errorf("Failed to save movie file: %s\n", m_movieFile.c_str());
+    }
 }
 
 void Debugger::BreakIntoDebugger(bool switchFocus) {
@@ -812,11 +876,22 @@ bool Debugger::FrameUpdate(double frameTime, const EmuEvents& emuEvents, const I
     }
 
     m_numInstructionsExecutedThisFrame = 0;
+    m_fastForward = false;
+    m_wholeFrame = false;
 
     for (auto& event : emuEvents) {
-        if (std::holds_alternative<EmuEvent::BreakIntoDebugger>(event.type)) {
+        if (std::holds_alternative<EmuEvent::FastForward>(event.type)) {
+            m_fastForward = true;
+        } else if (std::holds_alternative<EmuEvent::WholeFrame>(event.type)) {
+            m_wholeFrame = true;
+        } else if (std::holds_alternative<EmuEvent::BreakIntoDebugger>(event.type)) {
             BreakIntoDebugger();
             break;
+        } else if (auto rewind = std::get_if<EmuEvent::Rewind>(&event.type)) {
+            // If we're about to run a frame, go back one more, as it will replace it
+            const bool running = !m_breakIntoDebugger && frameTime > 0;
+            if (m_movieMode == MovieMode::None)
+                RewindFrames(rewind->frames + (running ? 1 : 0));
         }
     }
 
@@ -1113,6 +1188,16 @@ bool Debugger::FrameUpdate(double frameTime, const EmuEvents& emuEvents, const I
                 validCommand = false;
             }
 
+        } else if (tokens[0] == "rewind") {
+            const size_t frames = tokens.size() > 1 ? StringToIntegral<size_t>(tokens[1]) : 1;
+            if (m_movieMode != MovieMode::None) {
+                Printf("Can't rewind while recording or playing a movie\n");
+            } else if (RewindFrames(frames)) {
+                Printf("Rewound %zu frame(s)\n", frames);
+            } else {
+                Printf("Can't rewind more than %zu frame(s)\n", m_rewindBuffer.NumFrames());
+            }
+
         } else if (tokens[0] == "trace" || tokens[0] == "t") {
             size_t numLines = 10;
             const char* outFileName = nullptr;
@@ -1180,7 +1265,16 @@ bool Debugger::FrameUpdate(double frameTime, const EmuEvents& emuEvents, const I
         }
     } else { // Not broken into debugger (running)
 
-        ExecuteFrameInstructions(frameTime, input, renderContext, audioContext);
+        UpdateMovie(frameTime, input);
+        const double emulatedTime =
+            ExecuteFrameInstructions(frameTime, input, renderContext, audioContext);
+
+        // Only whole frames can be rewound to
+        if (!m_breakIntoDebugger && frameTime > 0)
+            PushRewindState();
+
+        if (m_runAheadFrames > 0 && !m_breakIntoDebugger && frameTime > 0 && !m_fastForward)
+            RunAhead(emulatedTime, input, renderContext, audioContext);
     }
 
     SyncInstructionHash(m_numInstructionsExecutedThisFrame);
@@ -1233,12 +1327,22 @@ void Debugger::CheckForBreakpoints() {
     }
 }
 
-void Debugger::ExecuteFrameInstructions(double frameTime, const Input& input,
-                                        RenderContext& renderContext, AudioContext& audioContext) {
+// Returns the time emulated, which is less than frameTime for whole frames
+double Debugger::ExecuteFrameInstructions(double frameTime, const Input& input,
+                                          RenderContext& renderContext,
+                                          AudioContext& audioContext) {
     // Execute as many instructions that can fit in this time slice (plus one more at most)
     const double cpuCyclesThisFrame = Cpu::Hz * frameTime;
     m_cpuCyclesLeft += cpuCyclesThisFrame;
 
+    // Whole frames also stop at the game's next frame boundary. Movies and the sync protocol
+    // replay the frame times, so they always run the whole time slice.
+    auto& via = m_emulator->GetVia();
+    const bool wholeFrame =
+        m_wholeFrame && m_movieMode == MovieMode::None && m_syncProtocol.IsStandalone();
+    const uint64_t frameBoundaryCount = via.FrameBoundaryCount();
+    const cycles_t startCyclesTotal = m_cpuCyclesTotal;
+
     while (m_cpuCyclesLeft > 0) {
         CheckForBreakpoints();
 
@@ -1247,7 +1351,27 @@ void Debugger::ExecuteFrameInstructions(double frameTime, const Input& input,
             break;
         }
 
-        const cycles_t elapsedCycles = ExecuteInstruction(input, renderContext, audioContext);
+        // Cycles to run before the output is needed again
+        double cyclesLeft = m_cpuCyclesLeft;
+        if (wholeFrame)
+            cyclesLeft = std::min(cyclesLeft, static_cast<double>(via.CyclesUntilFrameBoundary()));
+        const bool skipOutput = m_fastForward && cyclesLeft > FastForwardOutputCycles;
+        if (skipOutput)
+            cyclesLeft -= FastForwardOutputCycles;
+        m_emulator->SetOutputEnabled(!skipOutput);
+
+        // Run the rest of the frame in bulk if we can. Otherwise, skip over idle loops at once,
+        // unless we're counting instructions or have breakpoints that could be hit within them.
+        cycles_t elapsedCycles = 0;
+        if (CanRunCycles()) {
+            elapsedCycles = RunCycles(static_cast<cycles_t>(std::ceil(cyclesLeft)), input,
+                                      renderContext, audioContext);
+        } else if (!m_numInstructionsToExecute && m_breakpoints.Num() == 0) {
+            elapsedCycles = m_emulator->SkipIdleCycles(static_cast<cycles_t>(std::ceil(cyclesLeft)),
+                                                       input, renderContext, audioContext);
+        }
+        if (elapsedCycles == 0)
+            elapsedCycles = ExecuteInstruction(input, renderContext, audioContext);
 
         m_cpuCyclesTotal += elapsedCycles;
         m_cpuCyclesLeft -= elapsedCycles;
@@ -1257,11 +1381,17 @@ void Debugger::ExecuteFrameInstructions(double frameTime, const Input& input,
             BreakIntoDebugger();
         }
 
-        if (m_breakIntoDebugger) {
+        if (m_breakIntoDebugger || (wholeFrame && via.FrameBoundaryCount() != frameBoundaryCount)) {
             m_cpuCyclesLeft = 0;
             break;
         }
     }
+
+    m_emulator->SetOutputEnabled(true);
+
+    const double emulatedTime = (m_cpuCyclesTotal - startCyclesTotal) / Cpu::Hz;
+    renderContext.emulatedTime += emulatedTime;
+    return emulatedTime;
 }
 
 cycles_t Debugger::ExecuteInstruction(const Input& input, RenderContext& renderContext,
@@ -1298,7 +1428,7 @@ cycles_t Debugger::ExecuteInstruction(const Input& input, RenderContext& renderC
                 m_currTraceInfo = nullptr;
 
                 // Compute running hash of instruction trace
-                if (!m_syncProtocol.IsStandalone())
+                if (!m_syncProtocol.IsStandalone() || m_movieMode != MovieMode::None)
                     m_instructionHash = HashTraceInfo(traceInfo, m_instructionHash);
 
                 ++m_numInstructionsExecutedThisFrame;
@@ -1319,6 +1449,137 @@ cycles_t Debugger::ExecuteInstruction(const Input& input, RenderContext& renderC
     return static_cast<cycles_t>(0);
 };
 
+// Returns true if no per-instruction feature is active, so that instructions can be run in bulk
+// with RunCycles. Also updates the instruction breakpoints that RunCycles stops at.
+bool Debugger::CanRunCycles() {
+    if (m_traceEnabled || m_numInstructionsToExecute ||
+        !m_conditionalBreakpoints.Breakpoints().empty())
+        return false;
+
+    m_instructionBreakpoints.reset();
+    for (size_t i = 0; i < m_breakpoints.Num(); ++i) {
+        auto bp = m_breakpoints.GetAtIndex(i);
+        if (bp->type == Breakpoint::Type::Instruction) {
+            // Same as CheckForBreakpoints
+            if (bp->enabled || bp->once)
+                m_instructionBreakpoints.set(bp->address);
+        } else if (bp->enabled) {
+            // Watchpoints break from the memory bus callbacks, which RunCycles doesn't check
+            return false;
+        }
+    }
+    return true;
+}
+
+cycles_t Debugger::RunCycles(cycles_t cycles, const Input& input, RenderContext& renderContext,
+                             AudioContext& audioContext) {
+    // The call stack is only tracked when executing one instruction at a time
+    m_callStack.Clear();
+
+    try {
+        return m_emulator
+            ->RunCycles(cycles, input, renderContext, audioContext, &m_instructionBreakpoints)
+            .cycles;
+
+    } catch (std::exception& ex) {
+        Printf("Exception caught:\n%s\n", ex.what());
+    } catch (...) {
+        Printf("Unknown exception caught\n");
+    }
+    BreakIntoDebugger();
+    return static_cast<cycles_t>(0);
+}
+
+void Debugger::PushRewindState() {
+    m_emulator->SaveState(m_rewindState.data(), m_rewindState.size());
+    m_rewindBuffer.Push(m_rewindState.data());
+    m_rewindStateCycles = m_memoryBus->Cycles();
+}
+
+// Rewinds to the start of the frame that started the given number of frames ago, where the current
+// frame, if it's partially executed, counts as one.
+bool Debugger::RewindFrames(size_t frames) {
+    const bool atFrameStart = m_memoryBus->Cycles() == m_rewindStateCycles;
+    if (frames == 0 && !atFrameStart)
+        return true;
+
+    // The last pushed state is the start of the current frame
+    const size_t framesBack = atFrameStart ? frames : frames - 1;
+    if (!m_rewindBuffer.Rewind(framesBack, m_rewindState.data()))
+        return false;
+
+    m_emulator->LoadState(m_rewindState.data(), m_rewindState.size());
+    m_rewindStateCycles = m_memoryBus->Cycles();
+    m_cpuCyclesLeft = 0;
+    m_callStack.Clear();
+    return true;
+}
+
+// Reduces input latency by replacing the frame's lines with those of the frame m_runAheadFrames
+// frames ahead, emulated with the same input, and then rolling back. Only the skipped frames'
+// output is disabled: the frame's audio is kept, as it must play continuously. Frames run ahead
+// aren't traced, and don't stop at breakpoints.
+void Debugger::RunAhead(double frameTime, const Input& input, RenderContext& renderContext,
+                        AudioContext& audioContext) {
+    // Watchpoints would break on the accesses made while running ahead
+    for (size_t i = 0; i < m_breakpoints.Num(); ++i) {
+        auto bp = m_breakpoints.GetAtIndex(i);
+        if (bp->enabled && bp->type != Breakpoint::Type::Instruction)
+            return;
+    }
+
+    m_emulator->SaveState(m_runAheadState.data(), m_runAheadState.size());
+    const size_t numAudioSamples = audioContext.samples.size();
+    renderContext.lines.Clear();
+
+    try {
+        double cpuCyclesLeft = m_cpuCyclesLeft;
+        for (int frame = 1; frame <= m_runAheadFrames; ++frame) {
+            m_emulator->SetOutputEnabled(frame == m_runAheadFrames);
+            cpuCyclesLeft += Cpu::Hz * frameTime;
+            if (cpuCyclesLeft > 0) {
+                cpuCyclesLeft -= m_emulator
+                                     ->RunCycles(static_cast<cycles_t>(std::ceil(cpuCyclesLeft)),
+                                                 input, renderContext, audioContext)
+                                     .cycles;
+            }
+        }
+    } catch (...) {
+        // Errors will be reported when the frame is actually reached
+    }
+
+    m_emulator->SetOutputEnabled(true);
+    audioContext.samples.resize(numAudioSamples);
+    m_emulator->LoadState(m_runAheadState.data(), m_runAheadState.size());
+}
+
+// Records the frame's time and input to the movie, or replaces them with the movie's. Frames with
+// no time (e.g. paused) are skipped, as nothing is executed for them.
+void Debugger::UpdateMovie(double& frameTime, Input& input) {
+    if (frameTime == 0)
+        return;
+
+    if (m_movieMode == MovieMode::Record) {
+        m_movie.RecordFrame(frameTime, input);
+    } else if (m_movieMode == MovieMode::Play && !m_movie.PlayFrame(frameTime, input)) {
+        EndMoviePlayback();
+    }
+}
+
+void Debugger::EndMoviePlayback() {
+    const uint32_t expectedHash = m_movie.GetHeader().instructionHash;
+    Printf("Movie playback done after %zu frame(s), instruction hash $%08x", m_movie.NumFrames(),
+           m_instructionHash);
+    if (expectedHash != 0 && m_traceEnabled) {
+        if (expectedHash == m_instructionHash)
+            Printf(" (matches recording)");
+        else
+            Printf(" (MISMATCH, recorded $%08x)", expectedHash);
+    }
+    Printf("\n");
+    m_movieMode = MovieMode::None;
+}
+
 void Debugger::SyncInstructionHash(int numInstructionsExecutedThisFrame) {
     if (m_syncProtocol.IsStandalone())
         return;
@@ -9,10 +9,14 @@ class BiosRom : public IMemoryBusDevice {
 public:
     void Init(MemoryBus& memoryBus);
     bool LoadBiosRom(const char* file);
+    uint32_t Hash() const; // CRC-32C of the rom
 
 private:
     uint8_t Read(uint16_t address) const override;
     void Write(uint16_t address, uint8_t value) override;
 
+    void UpdateDirectMemory();
+
+    MemoryBus* m_memoryBus{};
     std::array<uint8_t, 8 * 1024> m_data{};
 };
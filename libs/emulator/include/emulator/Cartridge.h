@@ -8,11 +8,15 @@ public:
     void Init(MemoryBus& memoryBus);
     void Reset() {}
     bool LoadRom(const char* file);
+    uint32_t Hash() const; // CRC-32C of the rom, 0 if none is loaded
 
 private:
     uint8_t Read(uint16_t address) const override;
     void Write(uint16_t address, uint8_t value) override;
 
 private:
+    void UpdateDirectMemory();
+
+    MemoryBus* m_memoryBus{};
     std::vector<uint8_t> m_data;
 };
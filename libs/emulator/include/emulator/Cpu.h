@@ -2,8 +2,11 @@
 
 #include "core/Base.h"
 #include "core/Pimpl.h"
+#include <optional>
 
 class MemoryBus;
+class StateWriter;
+class StateReader;
 
 // Implementation of Motorola 68A09 1.5 MHz 8-Bit Microprocessor
 
@@ -73,6 +76,31 @@ public:
 
     const CpuRegisters& Registers() const;
 
+    // Same as Registers().PC, without computing the condition code flags
+    uint16_t PC() const;
+
+    // A loop in which the CPU does nothing but wait for a VIA interrupt flag to be set: either
+    // waiting in CWAI for an IRQ, or polling an address with BIT until any of the tested bits are
+    // set (e.g. the BIOS's Wait_Recal). See Emulator::SkipIdleCycles.
+    struct IdleLoop {
+        cycles_t cyclesPerIteration{};
+        // Cycle within an iteration at which its last instruction starts. This is the last time
+        // the CPU checks for interrupts, and, for polling loops, when the address is read.
+        cycles_t lastInstructionCycle{};
+        bool irqMasked{}; // If false, the loop also ends when an IRQ is raised
+        std::optional<uint16_t> pollAddress;
+        uint8_t pollMask{};
+    };
+
+    // Returns the idle loop the CPU is currently in, if any
+    std::optional<IdleLoop> FindIdleLoop() const;
+
+    // Updates CPU state as if iterations of idleLoop were executed. Does not add any cycles.
+    void SkipIdleLoop(const IdleLoop& idleLoop, cycles_t iterations);
+
+    void Serialize(StateWriter& stream);
+    void Serialize(StateReader& stream);
+
 private:
-    pimpl::Pimpl<class CpuImpl, 48> m_impl;
+    pimpl::Pimpl<class CpuImpl, 384> m_impl;
 };
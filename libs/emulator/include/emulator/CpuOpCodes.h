@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
 enum class AddressingMode {
@@ -359,38 +361,168 @@ constexpr bool IsOpCodePage2(uint8_t firstByte) {
     return firstByte == 0x11;
 }
 
-constexpr const CpuOp& FindCpuOp(const CpuOp table[], uint8_t opCode, int index = 0) {
-    return table[index].opCode == opCode ? table[index] : FindCpuOp(table, opCode, index + 1);
-}
+namespace Internal {
+    // Expands a sparse table of ops into a table of 256 ops indexed by opCode, with missing entries
+    // marked as illegal.
+    template <size_t N>
+    constexpr std::array<CpuOp, 256> MakeDenseCpuOpTable(const CpuOp (&ops)[N]) {
+        std::array<CpuOp, 256> table{};
+        for (size_t i = 0; i < table.size(); ++i) {
+            table[i] = {static_cast<uint8_t>(i), "Illegal", AddressingMode::Illegal, 1, 1, "Illegal"};
+        }
+        for (size_t i = 0; i < N; ++i) {
+            table[ops[i].opCode] = ops[i];
+        }
+        return table;
+    }
+} // namespace Internal
+
+// Dense tables of ops for each page, indexed by opCode
+inline constexpr std::array<std::array<CpuOp, 256>, 3> CpuOpTables = {
+    Internal::MakeDenseCpuOpTable(CpuOpsPage0),
+    Internal::MakeDenseCpuOpTable(CpuOpsPage1),
+    Internal::MakeDenseCpuOpTable(CpuOpsPage2),
+};
+static_assert(CpuOpTables[0][0x86].addrMode == AddressingMode::Immediate, "");
+static_assert(CpuOpTables[1][0x8E].opCode == 0x8E && CpuOpTables[1][0x8E].size == 4, "");
+static_assert(CpuOpTables[2][0x00].addrMode == AddressingMode::Illegal, "");
 
-// Compile-time lookup - use LookupCpuOpRuntime for runtime lookups
-//@TODO: Make this faster and get rid of LookupCpuOpRuntime! One way is to fill up the page 1+2
-// tables with invalid entries so that valid entries are on their opCode index so we can look them
-// up the same way we do page 0.
 constexpr const CpuOp& LookupCpuOp(int page, uint8_t opCode) {
-    return page == 0 ? CpuOpsPage0[opCode]
-                     : page == 1 ? FindCpuOp(CpuOpsPage1, opCode) : FindCpuOp(CpuOpsPage2, opCode);
+    return CpuOpTables[page][opCode];
 }
 
-// Faster version for runtime lookup
-inline const CpuOp& LookupCpuOpRuntime(int page, uint8_t opCode) {
-    auto InitLookupTables = [] {
-        // static std::array<const struct CpuOp*, 256> opCodeTables[3];
-        static const CpuOp* opCodeTables[3][256];
-        for (auto& opCodeTable : opCodeTables)
-            std::fill(std::begin(opCodeTable), std::end(opCodeTable), nullptr);
-
-        for (size_t i = 0; i < NumCpuOpsPage0; ++i)
-            opCodeTables[0][CpuOpsPage0[i].opCode] = &CpuOpsPage0[i];
-        for (size_t i = 0; i < NumCpuOpsPage1; ++i)
-            opCodeTables[1][CpuOpsPage1[i].opCode] = &CpuOpsPage1[i];
-        for (size_t i = 0; i < NumCpuOpsPage2; ++i)
-            opCodeTables[2][CpuOpsPage2[i].opCode] = &CpuOpsPage2[i];
-        return opCodeTables;
+// Describes how to compute the EA of an indexed addressing mode instruction from its postbyte
+struct IndexedPostbyte {
+    enum class Register : uint8_t { X, Y, U, S, PC, None };
+    enum class Offset : uint8_t {
+        None,
+        Constant, // 5 bit offset stored in constantOffset
+        A,
+        B,
+        D,
+        Immediate8,  // Next byte
+        Immediate16, // Next 2 bytes
     };
 
-    static const auto& lookupTables = InitLookupTables();
-    auto cpuOp = lookupTables[page][opCode];
-    ASSERT_MSG(cpuOp != nullptr, "Invalid CPU opcode: %d, page: %d", opCode, page);
-    return *cpuOp;
+    Register reg;
+    Offset offset;
+    int8_t constantOffset;
+    int8_t preIncrement;  // Added to reg before computing EA (-1 or -2 for ,-R and ,--R)
+    int8_t postIncrement; // Added to reg after computing EA (1 or 2 for ,R+ and ,R++)
+    bool indirect;        // EA is read from the computed address
+    bool illegal;
+    uint8_t cycles; // Extra cycles, not including the 3 cycles for indirection
+};
+
+namespace Internal {
+    constexpr IndexedPostbyte MakeIndexedPostbyte(uint8_t postbyte) {
+        using Register = IndexedPostbyte::Register;
+        using Offset = IndexedPostbyte::Offset;
+
+        IndexedPostbyte result{};
+        result.reg = static_cast<Register>((postbyte >> 5) & 0b11);
+        result.offset = Offset::None;
+
+        if ((postbyte & 0b1000'0000) == 0) { // (+/- 4 bit offset),R
+            // postbyte is a 5 bit two's complement number we convert to 8 bit
+            int constantOffset = postbyte & 0b0001'1111;
+            if (postbyte & 0b0001'0000)
+                constantOffset -= 0b0010'0000;
+            result.offset = Offset::Constant;
+            result.constantOffset = static_cast<int8_t>(constantOffset);
+            result.cycles = 1;
+            return result;
+        }
+
+        // Only some of these modes support indirection
+        bool supportsIndirect = true;
+
+        switch (postbyte & 0b1111) {
+        case 0b0000: // ,R+
+            result.postIncrement = 1;
+            supportsIndirect = false;
+            result.cycles = 2;
+            break;
+        case 0b0001: // ,R++
+            result.postIncrement = 2;
+            result.cycles = 3;
+            break;
+        case 0b0010: // ,-R
+            result.preIncrement = -1;
+            supportsIndirect = false;
+            result.cycles = 2;
+            break;
+        case 0b0011: // ,--R
+            result.preIncrement = -2;
+            result.cycles = 3;
+            break;
+        case 0b0100: // ,R
+            break;
+        case 0b0101: // (+/- B),R
+            result.offset = Offset::B;
+            result.cycles = 1;
+            break;
+        case 0b0110: // (+/- A),R
+            result.offset = Offset::A;
+            result.cycles = 1;
+            break;
+        case 0b1000: // (+/- 7 bit offset),R
+            result.offset = Offset::Immediate8;
+            result.cycles = 1;
+            break;
+        case 0b1001: // (+/- 15 bit offset),R
+            result.offset = Offset::Immediate16;
+            result.cycles = 4;
+            break;
+        case 0b1011: // (+/- D),R
+            result.offset = Offset::D;
+            result.cycles = 4;
+            break;
+        case 0b1100: // (+/- 7 bit offset),PC
+            result.reg = Register::PC;
+            result.offset = Offset::Immediate8;
+            result.cycles = 1;
+            break;
+        case 0b1101: // (+/- 15 bit offset),PC
+            result.reg = Register::PC;
+            result.offset = Offset::Immediate16;
+            result.cycles = 5;
+            break;
+        case 0b1111: // [address] (Indirect-only)
+            result.reg = Register::None;
+            result.offset = Offset::Immediate16;
+            result.cycles = 2;
+            break;
+        default: // 0b0111, 0b1010, 0b1110
+            result.reg = Register::None;
+            result.illegal = true;
+            break;
+        }
+
+        if (supportsIndirect && (postbyte & 0b0001'0000))
+            result.indirect = true;
+
+        return result;
+    }
+
+    constexpr std::array<IndexedPostbyte, 256> MakeIndexedPostbyteTable() {
+        std::array<IndexedPostbyte, 256> table{};
+        for (size_t i = 0; i < table.size(); ++i) {
+            table[i] = MakeIndexedPostbyte(static_cast<uint8_t>(i));
+        }
+        return table;
+    }
+} // namespace Internal
+
+// Table of indexed addressing mode descriptors, indexed by postbyte
+inline constexpr std::array<IndexedPostbyte, 256> IndexedPostbytes =
+    Internal::MakeIndexedPostbyteTable();
+static_assert(IndexedPostbytes[0x9F].reg == IndexedPostbyte::Register::None &&
+                  IndexedPostbytes[0x9F].indirect && IndexedPostbytes[0x9F].cycles == 2,
+              "");
+static_assert(IndexedPostbytes[0x1F].constantOffset == -1 && !IndexedPostbytes[0x1F].indirect,
+              "");
+
+constexpr const IndexedPostbyte& LookupIndexedPostbyte(uint8_t postbyte) {
+    return IndexedPostbytes[postbyte];
 }
@@ -19,16 +19,27 @@ public:
     }
 
     void Update(cycles_t cycles) {
-        (void)cycles;
-        assert(cycles == 1);
-        if (m_cyclesLeft > 0 && --m_cyclesLeft == 0) {
-            m_value = m_nextValue;
+        if (m_cyclesLeft > 0) {
+            if (cycles >= m_cyclesLeft) {
+                m_cyclesLeft = 0;
+                m_value = m_nextValue;
+            } else {
+                m_cyclesLeft -= cycles;
+            }
         }
     }
 
+    // Number of cycles until the next value is returned, or 0 if no value is pending
+    cycles_t CyclesUntilUpdate() const { return m_cyclesLeft; }
+
     const T& Value() const { return m_value; }
     operator const T&() const { return Value(); }
 
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(m_cyclesLeft, m_nextValue, m_value);
+    }
+
 private:
     cycles_t m_cyclesLeft{};
     T m_nextValue{};
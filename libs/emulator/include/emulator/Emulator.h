@@ -9,25 +9,70 @@
 #include "emulator/Ram.h"
 #include "emulator/UnmappedMemoryDevice.h"
 #include "emulator/Via.h"
+#include <bitset>
 
 class Emulator {
 public:
     void Init(const char* biosRomFile);
     void Reset();
+    void Reset(unsigned int ramSeed); // For reproducible runs (see Movie)
     bool LoadBios(const char* file);
     bool LoadRom(const char* file);
+    uint32_t BiosHash() const { return m_biosRom.Hash(); }
+    uint32_t RomHash() const { return m_cartridge.Hash(); }
 
     cycles_t ExecuteInstruction(const Input& input, RenderContext& renderContext,
                                 AudioContext& audioContext);
 
+    // If the CPU is idle, waiting for a VIA interrupt (in CWAI, or polling the interrupt flags in a
+    // loop), advances all devices over the idle iterations in one go. The result is exactly the
+    // same as calling ExecuteInstruction while cyclesLeft > 0 (subtracting the returned cycles
+    // each time), stopping when the CPU would stop idling. Returns the number of cycles skipped,
+    // or 0 if none could be, in which case ExecuteInstruction should be called.
+    cycles_t SkipIdleCycles(cycles_t cyclesLeft, const Input& input, RenderContext& renderContext,
+                            AudioContext& audioContext);
+
+    // Addresses of instructions before which RunCycles must stop
+    using InstructionBreakpoints = std::bitset<0x10000>;
+
+    struct RunResult {
+        cycles_t cycles{};
+        uint64_t instructions{}; // Instructions actually executed (not counting skipped idle loops)
+        bool breakpointHit{};
+    };
+
+    // Executes instructions until at least the given number of cycles have elapsed, or the next
+    // instruction is at one of the breakpoints. The result is exactly the same as calling
+    // ExecuteInstruction in a loop, but devices are only synced when they're accessed or have a
+    // pending event, and once more at the end. Exceptions (e.g. illegal instructions) propagate
+    // to the caller, leaving devices unsynced.
+    RunResult RunCycles(cycles_t cycles, const Input& input, RenderContext& renderContext,
+                        AudioContext& audioContext,
+                        const InstructionBreakpoints* breakpoints = nullptr);
+
     void FrameUpdate(double frameTime);
 
+    // See Via::SetOutputEnabled
+    void SetOutputEnabled(bool enabled) { m_via.SetOutputEnabled(enabled); }
+
+    // Save states are a fixed-size binary snapshot of the machine (CPU, VIA, RAM, etc.), excluding
+    // the roms, which must be loaded before loading a state. Saving and loading don't allocate,
+    // and must be done between instructions. Both return false if size is less than StateSize(),
+    // and LoadState returns false if the state was saved by an incompatible version, in which
+    // case the machine's state is left unchanged.
+    size_t StateSize() const;
+    bool SaveState(uint8_t* data, size_t size) const;
+    bool LoadState(const uint8_t* data, size_t size);
+
     MemoryBus& GetMemoryBus() { return m_memoryBus; }
     Cpu& GetCpu() { return m_cpu; }
     Ram& GetRam() { return m_ram; }
     Via& GetVia() { return m_via; }
 
 private:
+    template <typename Stream>
+    void Serialize(Stream& stream);
+
     MemoryBus m_memoryBus;
     Cpu m_cpu;
     Via m_via;
@@ -3,7 +3,7 @@
 #include "core/Base.h"
 #include "core/BitOps.h"
 #include "core/FileSystem.h"
-#include "core/Line.h"
+#include "core/LineBuffer.h"
 #include <array>
 #include <functional>
 #include <variant>
@@ -45,7 +45,8 @@ private:
 };
 
 struct RenderContext {
-    std::vector<Line> lines; // Lines to draw this frame
+    LineBuffer lines;      // Lines to draw this frame
+    double emulatedTime{}; // Time emulated to draw them, in seconds
 };
 
 struct AudioContext {
@@ -66,8 +67,18 @@ public:
     struct OpenRomFile {
         fs::path path{}; // If not set, use open file dialog
     };
+    struct Rewind {
+        int frames{};
+    };
+    // Sent every frame while fast-forwarding: only the last emulated frame's output is needed
+    struct FastForward {};
+    // Sent every frame when pacing to the game's frames: emulate up to the game's next frame
+    // boundary (see Via::FrameBoundaryCount), with the frame time as the most to emulate, and
+    // report the time emulated in RenderContext::emulatedTime.
+    struct WholeFrame {};
 
-    using Type = std::variant<BreakIntoDebugger, Reset, OpenBiosRomFile, OpenRomFile>;
+    using Type = std::variant<BreakIntoDebugger, Reset, OpenBiosRomFile, OpenRomFile, Rewind,
+                              FastForward, WholeFrame>;
     Type type;
 };
 using EmuEvents = std::vector<EmuEvent>;
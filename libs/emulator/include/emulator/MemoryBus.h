@@ -3,7 +3,10 @@
 #include "core/Base.h"
 #include "core/ErrorHandler.h"
 #include <algorithm>
+#include <array>
 #include <functional>
+#include <limits>
+#include <optional>
 #include <vector>
 
 using MemoryRange = std::pair<uint16_t, uint16_t>;
@@ -12,19 +15,56 @@ struct IMemoryBusDevice {
     virtual uint8_t Read(uint16_t address) const = 0;
     virtual void Write(uint16_t address, uint8_t value) = 0;
     virtual void Sync(cycles_t cycles) { (void)cycles; }
+
+    // For sync-enabled devices: number of cycles from the last Sync (or access) until the device
+    // must be synced, even if it isn't accessed (e.g. when a timer expires).
+    static constexpr cycles_t NoPendingEvent = std::numeric_limits<cycles_t>::max();
+    virtual cycles_t CyclesUntilNextEvent() const { return NoPendingEvent; }
 };
 
 enum class EnableSync { False, True };
+enum class DirectAccess { ReadOnly, ReadWrite };
 
 class MemoryBus {
 public:
+    static constexpr size_t PageSize = 256;
+    static constexpr size_t NumPages = 0x10000 / PageSize;
+
     void ConnectDevice(IMemoryBusDevice& device, MemoryRange range, EnableSync enableSync) {
-        m_devices.push_back(DeviceInfo{&device, range, enableSync == EnableSync::True});
+        // Address decoding is done per page, so ranges must start and end on page boundaries
+        ASSERT_MSG((range.first % PageSize) == 0 && (range.second % PageSize) == PageSize - 1,
+                   "Memory range [$%04x, $%04x] is not page aligned", range.first, range.second);
+
+        m_devices.push_back(
+            DeviceInfo{&device, range, enableSync == EnableSync::True, m_cycles});
 
         std::sort(m_devices.begin(), m_devices.end(),
                   [](const DeviceInfo& info1, const DeviceInfo& info2) {
                       return info1.memoryRange.first < info2.memoryRange.first;
                   });
+
+        RebuildPageTable();
+    }
+
+    // Devices that are plain byte arrays can expose their backing memory so that the CPU can
+    // access it directly, bypassing the virtual Read/Write. An address in the device's range maps
+    // to data[(address - range.first) & mirrorMask]. Pages that fall outside of size are still
+    // accessed through the device. Must be called again if data is reallocated.
+    void SetDirectMemory(IMemoryBusDevice& device, uint8_t* data, size_t size, uint16_t mirrorMask,
+                         DirectAccess access) {
+        bool found = false;
+        for (auto& info : m_devices) {
+            if (info.device == &device) {
+                info.directData = data;
+                info.directSize = size;
+                info.directMirrorMask = mirrorMask;
+                info.directAccess = access;
+                found = true;
+            }
+        }
+        ASSERT_MSG(found, "Device must be connected before setting its direct memory");
+
+        RebuildPageTable();
     }
 
     //@TODO: Move this callback stuff out of here, perhaps in some DebuggerMemoryBus class.
@@ -33,13 +73,86 @@ public:
     void RegisterCallbacks(OnReadCallback onReadCallback, OnWriteCallback onWriteCallback) {
         m_onReadCallback = onReadCallback;
         m_onWriteCallback = onWriteCallback;
+
+        // Callbacks must see every access, so direct access is disabled while they're registered
+        RebuildPageTable();
+    }
+
+    // Dirty tracking records which blocks of DirtyBlockSize bytes are written to. While enabled,
+    // direct write access is disabled, so that all writes go through Write. When disabled, it costs
+    // a single branch per Write.
+    static constexpr size_t DirtyBlockSize = 32;
+
+    void SetDirtyTrackingEnabled(bool enabled) {
+        if (enabled == m_dirtyTrackingEnabled)
+            return;
+        m_dirtyTrackingEnabled = enabled;
+        m_dirtyBlocks.fill(0);
+        RebuildPageTable();
+    }
+
+    bool DirtyTrackingEnabled() const { return m_dirtyTrackingEnabled; }
+
+    // Marks all memory as written to, e.g. when it was changed without going through Write
+    void MarkAllDirty() {
+        if (m_dirtyTrackingEnabled)
+            m_dirtyBlocks.fill(~uint64_t{0});
     }
 
+    // Calls onRange(MemoryRange) for each range of memory written to since the last call, merging
+    // adjacent blocks, and clears them.
+    template <typename OnRange>
+    void CollectDirtyRanges(OnRange onRange) {
+        auto RangeOfBlocks = [](size_t firstBlock, size_t endBlock) {
+            return MemoryRange{static_cast<uint16_t>(firstBlock * DirtyBlockSize),
+                               static_cast<uint16_t>(endBlock * DirtyBlockSize - 1)};
+        };
+
+        std::optional<size_t> rangeFirstBlock;
+        for (size_t word = 0; word < m_dirtyBlocks.size(); ++word) {
+            const uint64_t bits = m_dirtyBlocks[word];
+
+            // Nothing starts or ends in this word
+            if ((bits == 0 && !rangeFirstBlock) || (bits == ~uint64_t{0} && rangeFirstBlock))
+                continue;
+
+            for (size_t bit = 0; bit < 64; ++bit) {
+                const size_t block = word * 64 + bit;
+                const bool dirty = (bits >> bit) & 1;
+                if (dirty && !rangeFirstBlock) {
+                    rangeFirstBlock = block;
+                } else if (!dirty && rangeFirstBlock) {
+                    onRange(RangeOfBlocks(*rangeFirstBlock, block));
+                    rangeFirstBlock.reset();
+                }
+            }
+        }
+        if (rangeFirstBlock)
+            onRange(RangeOfBlocks(*rangeFirstBlock, NumDirtyBlocks));
+
+        m_dirtyBlocks.fill(0);
+    }
+
+    // Returns a pointer to the direct memory backing the page that contains address, or nullptr if
+    // the access must go through Read/Write. Index the result with (address % PageSize).
+    const uint8_t* DirectReadPage(uint16_t address) const {
+        return m_directReadPages[address / PageSize];
+    }
+    uint8_t* DirectWritePage(uint16_t address) const {
+        return m_directWritePages[address / PageSize];
+    }
+
+    // Incremented whenever the direct memory pages change, e.g. when a rom is loaded or callbacks
+    // are registered. Anything cached from read-only direct memory must be discarded when this
+    // changes.
+    uint32_t DirectMemoryVersion() const { return m_directMemoryVersion; }
+
     uint8_t Read(uint16_t address) const {
         auto& deviceInfo = FindDeviceInfo(address);
         SyncDevice(deviceInfo);
 
         uint8_t value = deviceInfo.device->Read(address);
+        UpdateNextEvent(deviceInfo);
 
         if (m_onReadCallback)
             m_onReadCallback(address, value);
@@ -51,10 +164,16 @@ public:
         if (m_onWriteCallback)
             m_onWriteCallback(address, value);
 
+        if (m_dirtyTrackingEnabled) {
+            const size_t block = address / DirtyBlockSize;
+            m_dirtyBlocks[block / 64] |= uint64_t{1} << (block % 64);
+        }
+
         auto& deviceInfo = FindDeviceInfo(address);
         SyncDevice(deviceInfo);
 
         deviceInfo.device->Write(address, value);
+        UpdateNextEvent(deviceInfo);
     }
 
     uint8_t ReadRaw(uint16_t address) const {
@@ -69,38 +188,99 @@ public:
         return static_cast<uint16_t>(high) << 8 | static_cast<uint16_t>(low);
     }
 
-    void AddSyncCycles(cycles_t cycles) {
-        //@TODO: optimize this so we don't loop through all devices every time we add cycles
-        for (auto& deviceInfo : m_devices) {
-            if (deviceInfo.syncEnabled)
-                deviceInfo.syncCycles += cycles;
+    // Advances the global cycle clock. Sync-enabled devices are only caught up lazily, when
+    // they're accessed, when Sync is called, or when their next event is due.
+    void AddCycles(cycles_t cycles) {
+        m_cycles += cycles;
+        if (m_cycles >= m_nextEventCycle) {
+            for (auto& deviceInfo : m_devices) {
+                if (deviceInfo.nextEventCycle <= m_cycles)
+                    SyncDevice(deviceInfo);
+            }
         }
     }
 
+    cycles_t Cycles() const { return m_cycles; }
+
+    // Cycle at which the earliest pending device event is due, or NoPendingEvent
+    cycles_t NextEventCycle() const { return m_nextEventCycle; }
+
     void Sync() {
         for (auto& deviceInfo : m_devices) {
             SyncDevice(deviceInfo);
         }
     }
 
+    // Must be serialized after the devices, as their next events are recomputed on load
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(m_cycles);
+
+        if constexpr (Stream::IsLoading) {
+            // States are saved between instructions, when all devices are synced
+            for (auto& deviceInfo : m_devices) {
+                deviceInfo.lastSyncCycle = m_cycles;
+            }
+            for (auto& deviceInfo : m_devices) {
+                UpdateNextEvent(deviceInfo);
+            }
+
+            // Memory was restored without going through Write
+            MarkAllDirty();
+        }
+    }
+
 private:
+
     struct DeviceInfo {
         IMemoryBusDevice* device = nullptr;
         MemoryRange memoryRange;
         bool syncEnabled = false;
-        mutable cycles_t syncCycles = 0;
+        mutable cycles_t lastSyncCycle = 0;
+        mutable cycles_t nextEventCycle = IMemoryBusDevice::NoPendingEvent;
+
+        uint8_t* directData = nullptr;
+        size_t directSize = 0;
+        uint16_t directMirrorMask = 0;
+        DirectAccess directAccess = DirectAccess::ReadOnly;
     };
 
-    const DeviceInfo& FindDeviceInfo(uint16_t address) const {
-        // We assume at least 1 device is connected. This one condition allows us to check the
-        // address against the end of each range in the inner loop.
-        if (address >= m_devices[0].memoryRange.first) {
-            for (const auto& info : m_devices) {
-                if (address <= info.memoryRange.second) {
-                    return info;
-                }
+    // Maps each page to the device that owns it. Must be rebuilt whenever m_devices changes, as
+    // it stores pointers into it.
+    void RebuildPageTable() {
+        ++m_directMemoryVersion;
+        m_pageTable.fill(nullptr);
+        m_directReadPages.fill(nullptr);
+        m_directWritePages.fill(nullptr);
+
+        for (const auto& info : m_devices) {
+            for (size_t page = info.memoryRange.first / PageSize;
+                 page <= info.memoryRange.second / PageSize; ++page) {
+                m_pageTable[page] = &info;
+
+                // Devices that need syncing must see every access
+                if (!info.directData || info.syncEnabled)
+                    continue;
+
+                const size_t offset =
+                    ((page * PageSize) - info.memoryRange.first) & info.directMirrorMask;
+                if (offset + PageSize > info.directSize)
+                    continue;
+
+                if (!m_onReadCallback)
+                    m_directReadPages[page] = info.directData + offset;
+
+                if (!m_onWriteCallback && !m_dirtyTrackingEnabled &&
+                    info.directAccess == DirectAccess::ReadWrite)
+                    m_directWritePages[page] = info.directData + offset;
             }
         }
+    }
+
+    const DeviceInfo& FindDeviceInfo(uint16_t address) const {
+        if (auto info = m_pageTable[address / PageSize]) {
+            return *info;
+        }
 
         ErrorHandler::Undefined("Unmapped address: $%02x\n", address);
 
@@ -113,14 +293,41 @@ private:
     }
 
     void SyncDevice(const DeviceInfo& deviceInfo) const {
-        if (deviceInfo.syncCycles > 0) {
-            deviceInfo.device->Sync(deviceInfo.syncCycles);
-            deviceInfo.syncCycles = 0;
+        if (deviceInfo.syncEnabled && deviceInfo.lastSyncCycle < m_cycles) {
+            deviceInfo.device->Sync(m_cycles - deviceInfo.lastSyncCycle);
+            deviceInfo.lastSyncCycle = m_cycles;
+            UpdateNextEvent(deviceInfo);
+        }
+    }
+
+    // Must be called whenever a sync-enabled device's state may have changed
+    void UpdateNextEvent(const DeviceInfo& deviceInfo) const {
+        if (!deviceInfo.syncEnabled)
+            return;
+
+        const cycles_t cycles = deviceInfo.device->CyclesUntilNextEvent();
+        deviceInfo.nextEventCycle = cycles == IMemoryBusDevice::NoPendingEvent
+                                        ? IMemoryBusDevice::NoPendingEvent
+                                        : deviceInfo.lastSyncCycle + cycles;
+
+        m_nextEventCycle = IMemoryBusDevice::NoPendingEvent;
+        for (const auto& info : m_devices) {
+            m_nextEventCycle = std::min(m_nextEventCycle, info.nextEventCycle);
         }
     }
 
     // Sorted by first address in range
     std::vector<DeviceInfo> m_devices;
+    cycles_t m_cycles = 0;
+    mutable cycles_t m_nextEventCycle = IMemoryBusDevice::NoPendingEvent;
+    std::array<const DeviceInfo*, NumPages> m_pageTable{};
+    std::array<const uint8_t*, NumPages> m_directReadPages{};
+    std::array<uint8_t*, NumPages> m_directWritePages{};
+    uint32_t m_directMemoryVersion = 0;
+
+    static constexpr size_t NumDirtyBlocks = 0x10000 / DirtyBlockSize;
+    bool m_dirtyTrackingEnabled = false;
+    std::array<uint64_t, NumDirtyBlocks / 64> m_dirtyBlocks{};
 
     OnReadCallback m_onReadCallback;
     OnWriteCallback m_onWriteCallback;
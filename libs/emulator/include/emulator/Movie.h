@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/Base.h"
+#include "emulator/EngineTypes.h"
+#include <array>
+#include <vector>
+
+// Recording of the inputs of an emulation session, from reset, that can be replayed to reproduce
+// the exact same session: the seed the RAM was randomized with, the hashes of the BIOS and rom it
+// was recorded with, and the frame time and Input of each frame. Both are stored as runs of
+// identical values, as they rarely change from one frame to the next. Movies can also hold the
+// running instruction hash (see Trace::HashTraceInfo) at the end of the recording, to check replays
+// against.
+class Movie {
+public:
+    struct Header {
+        uint32_t ramSeed{};
+        uint32_t biosHash{};
+        uint32_t romHash{};
+        uint32_t instructionHash{}; // 0 if not computed
+    };
+
+    // Clears all frames and starts recording from the given header
+    void BeginRecording(const Header& header);
+    void RecordFrame(double frameTime, const Input& input);
+
+    // Restarts playback from the first frame. PlayFrame returns false once all frames are played.
+    void BeginPlayback();
+    bool PlayFrame(double& frameTime, Input& input);
+
+    Header& GetHeader() { return m_header; }
+    const Header& GetHeader() const { return m_header; }
+    size_t NumFrames() const { return m_numFrames; }
+    size_t NumPlayedFrames() const { return m_playedFrames; }
+
+    bool Save(const char* file) const;
+    bool Load(const char* file);
+
+private:
+    // Input reduced to what the emulator reads, with a portable layout
+    struct InputValue {
+        uint8_t buttons = 0xFF;
+        std::array<int8_t, 4> axes{};
+
+        bool operator==(const InputValue& rhs) const {
+            return buttons == rhs.buttons && axes == rhs.axes;
+        }
+    };
+
+    template <typename T>
+    struct Run {
+        uint32_t count{};
+        T value{};
+    };
+
+    template <typename T>
+    struct Track {
+        std::vector<Run<T>> runs;
+        size_t currRun{};
+        uint32_t currRunFrame{}; // Frames of the current run already played
+
+        void Record(const T& value);
+        void BeginPlayback();
+        bool Play(T& value);
+    };
+
+    static InputValue ToInputValue(const Input& input);
+    static Input ToInput(const InputValue& value);
+
+    Header m_header;
+    size_t m_numFrames{};
+    size_t m_playedFrames{};
+    Track<double> m_frameTimes;
+    Track<InputValue> m_inputs;
+};
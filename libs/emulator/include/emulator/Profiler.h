@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/Base.h"
+#include <array>
+#include <chrono>
+#include <iterator>
+
+// Accumulates the wall time spent in each emulator subsystem (see vectrexy_bench). Time is
+// exclusive: time spent in a nested section is only counted for that section. Profiling is
+// disabled by default, in which case a ScopedSection costs a single branch. Not thread-safe.
+namespace Profiler {
+    enum class Section { Other, Cpu, Via, Psg, Screen, RenderContext, Count };
+
+    inline const char* SectionName(Section section) {
+        constexpr const char* names[] = {"other", "cpu", "via", "psg", "screen", "renderContext"};
+        static_assert(std::size(names) == static_cast<size_t>(Section::Count), "");
+        return names[static_cast<size_t>(section)];
+    }
+
+    namespace Internal {
+        using Clock = std::chrono::steady_clock;
+
+        inline bool g_enabled = false;
+        inline Section g_currSection = Section::Other;
+        inline Clock::time_point g_lastSwitchTime{};
+        inline std::array<Clock::duration, static_cast<size_t>(Section::Count)> g_sectionTimes{};
+
+        // Charges time elapsed since the last switch to the current section, and makes section
+        // current. Returns the previously current section.
+        inline Section SwitchTo(Section section) {
+            const auto now = Clock::now();
+            g_sectionTimes[static_cast<size_t>(g_currSection)] += now - g_lastSwitchTime;
+            g_lastSwitchTime = now;
+            const auto prevSection = g_currSection;
+            g_currSection = section;
+            return prevSection;
+        }
+    } // namespace Internal
+
+    // Clears all accumulated times and starts profiling
+    inline void Start() {
+        Internal::g_enabled = true;
+        Internal::g_currSection = Section::Other;
+        Internal::g_lastSwitchTime = Internal::Clock::now();
+        Internal::g_sectionTimes = {};
+    }
+
+    // Stops profiling, keeping accumulated times
+    inline void Stop() {
+        if (Internal::g_enabled) {
+            Internal::SwitchTo(Section::Other);
+            Internal::g_enabled = false;
+        }
+    }
+
+    inline bool IsEnabled() { return Internal::g_enabled; }
+
+    // Time spent in section up to the last Stop()
+    inline double Seconds(Section section) {
+        return std::chrono::duration<double>(
+                   Internal::g_sectionTimes[static_cast<size_t>(section)])
+            .count();
+    }
+
+    class ScopedSection {
+    public:
+        explicit ScopedSection(Section section) {
+            if (Internal::g_enabled) {
+                m_prevSection = Internal::SwitchTo(section);
+                m_active = true;
+            }
+        }
+
+        ~ScopedSection() {
+            if (m_active)
+                Internal::SwitchTo(m_prevSection);
+        }
+
+        ScopedSection(const ScopedSection&) = delete;
+        ScopedSection& operator=(const ScopedSection&) = delete;
+
+    private:
+        Section m_prevSection{};
+        bool m_active = false;
+    };
+} // namespace Profiler
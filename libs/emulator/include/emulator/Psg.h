@@ -3,6 +3,9 @@
 #include "core/Base.h"
 #include "core/Pimpl.h"
 
+class StateWriter;
+class StateReader;
+
 // Implementation of the AY-3-8912 Programmable Sound Generator (PSG)
 
 class Psg {
@@ -23,10 +26,16 @@ public:
     void Reset();
     void Update(cycles_t cycles);
 
+    // Number of cycles that can be updated without Sample() changing
+    cycles_t CyclesUntilOutputChange() const;
+
     float Sample() const;
 
     void FrameUpdate(double frameTime);
 
+    void Serialize(StateWriter& stream);
+    void Serialize(StateReader& stream);
+
 private:
     pimpl::Pimpl<class PsgImpl, 256> m_impl;
 };
@@ -9,6 +9,9 @@ class Ram : public IMemoryBusDevice {
 public:
     void Init(MemoryBus& memoryBus) {
         memoryBus.ConnectDevice(*this, MemoryMap::Ram.range, EnableSync::False);
+        memoryBus.SetDirectMemory(*this, m_data.data(), m_data.size(),
+                                  static_cast<uint16_t>(m_data.size() - 1),
+                                  DirectAccess::ReadWrite);
     }
 
     void Zero() { std::fill(m_data.begin(), m_data.end(), static_cast<uint8_t>(0)); }
@@ -21,6 +24,11 @@ public:
                        [&](auto&) { return static_cast<uint8_t>(distribution(engine)); });
     }
 
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(m_data);
+    }
+
 private:
     uint8_t Read(uint16_t address) const override {
         return m_data[MemoryMap::Ram.MapAddress(address)];
@@ -31,4 +39,5 @@ private:
     }
 
     std::array<uint8_t, 1024> m_data{};
+    static_assert(MemoryMap::Ram.logicalSize == 1024, "");
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/Base.h"
+#include <vector>
+
+// Keeps the most recent emulator states (see Emulator::SaveState), typically one per frame, within
+// a fixed memory budget. Every keyframeInterval'th state is stored whole, and the others as the
+// run-length encoded XOR against the previous state, which is mostly zeros, as little of the
+// machine's state changes in a frame. When full, the oldest keyframe and its deltas are discarded.
+// All memory is allocated in Init.
+class RewindBuffer {
+public:
+    // memoryBudget is the total number of bytes used, including bookkeeping, and must be large
+    // enough to hold at least a few keyframes.
+    void Init(size_t stateSize, size_t memoryBudget, size_t maxFrames,
+              size_t keyframeInterval = 60);
+    void Clear();
+
+    void Push(const uint8_t* state);
+
+    size_t NumFrames() const { return m_numFrames; }
+
+    // Writes the state pushed framesBack frames before the last one (0 for the last one) to state.
+    // Returns false if there aren't that many frames.
+    bool Peek(size_t framesBack, uint8_t* state) const;
+
+    // Same as Peek, but also discards the states pushed after the returned one, so that subsequent
+    // pushes continue from it.
+    bool Rewind(size_t framesBack, uint8_t* state);
+
+private:
+    struct FrameRecord {
+        uint32_t offset{}; // In m_data
+        uint32_t size{};
+        bool keyframe{};
+    };
+
+    const FrameRecord& Frame(size_t index) const {
+        return m_frames[(m_firstFrame + index) % m_frames.size()];
+    }
+    size_t EncodeDelta(const uint8_t* state, const uint8_t* prevState, uint8_t* out) const;
+    void ApplyDelta(const uint8_t* delta, size_t deltaSize, uint8_t* state) const;
+    bool Allocate(size_t size, uint32_t& offset) const;
+    void DiscardOldestKeyframe();
+
+    size_t m_stateSize{};
+    size_t m_keyframeInterval{};
+
+    std::vector<uint8_t> m_data; // Ring buffer of frame records' data
+    uint32_t m_dataEnd{};        // Offset after the last frame's data
+
+    std::vector<FrameRecord> m_frames; // Ring buffer
+    size_t m_firstFrame{};
+    size_t m_numFrames{};
+    size_t m_framesSinceKeyframe{};
+
+    std::vector<uint8_t> m_lastState;
+    std::vector<uint8_t> m_encodeBuffer;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core/Base.h"
+#include "core/ErrorHandler.h"
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Streams used to save and load emulator state to and from a fixed-size buffer, without
+// allocating (see Emulator::SaveState). Components implement a single function for both:
+//
+//     template <typename Stream>
+//     void Serialize(Stream& stream) { stream(m_value, m_otherValue, m_childComponent); }
+//
+// Values with a Serialize member are serialized through it; all others must be trivially copyable,
+// and are copied byte for byte. States are therefore only compatible between builds for the same
+// platform.
+
+namespace SaveStateInternal {
+    template <typename T, typename Stream, typename = void>
+    struct HasSerialize : std::false_type {};
+
+    template <typename T, typename Stream>
+    struct HasSerialize<
+        T, Stream, std::void_t<decltype(std::declval<T&>().Serialize(std::declval<Stream&>()))>>
+        : std::true_type {};
+} // namespace SaveStateInternal
+
+class StateWriter {
+public:
+    static constexpr bool IsLoading = false;
+
+    // If data is null, nothing is written, which is used to compute the size of a state
+    StateWriter(uint8_t* data, size_t size)
+        : m_data(data)
+        , m_size(size) {}
+
+    template <typename... Ts>
+    void operator()(Ts&... values) {
+        (Write(values), ...);
+    }
+
+    size_t Offset() const { return m_offset; }
+
+private:
+    template <typename T>
+    void Write(T& value) {
+        if constexpr (SaveStateInternal::HasSerialize<T, StateWriter>::value) {
+            value.Serialize(*this);
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>, "Implement Serialize for this type");
+            if (m_data) {
+                ASSERT(m_offset + sizeof(T) <= m_size);
+                std::memcpy(m_data + m_offset, &value, sizeof(T));
+            }
+            m_offset += sizeof(T);
+        }
+    }
+
+    uint8_t* m_data{};
+    size_t m_size{};
+    size_t m_offset{};
+};
+
+class StateReader {
+public:
+    static constexpr bool IsLoading = true;
+
+    StateReader(const uint8_t* data, size_t size)
+        : m_data(data)
+        , m_size(size) {}
+
+    template <typename... Ts>
+    void operator()(Ts&... values) {
+        (Read(values), ...);
+    }
+
+    size_t Offset() const { return m_offset; }
+
+private:
+    template <typename T>
+    void Read(T& value) {
+        if constexpr (SaveStateInternal::HasSerialize<T, StateReader>::value) {
+            value.Serialize(*this);
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>, "Implement Serialize for this type");
+            ASSERT(m_offset + sizeof(T) <= m_size);
+            std::memcpy(&value, m_data + m_offset, sizeof(T));
+            m_offset += sizeof(T);
+        }
+    }
+
+    const uint8_t* m_data{};
+    size_t m_size{};
+    size_t m_offset{};
+};
@@ -3,6 +3,7 @@
 #include "core/Vector2.h"
 #include "emulator/DelayedValueStore.h"
 
+struct Line;
 struct RenderContext;
 
 // Models the actual 9" screen that comes with a Vectrex, including hardware delays when moving the
@@ -23,7 +24,30 @@ public:
 
     void SetBrightnessCurve(float v) { m_brightnessCurve = v; }
 
+    // While disabled, the beam still moves exactly as it would, but no lines are output
+    void SetOutputEnabled(bool enabled) { m_outputEnabled = enabled; }
+
+    // Lines that aren't output because they continue the previous one closely enough that it was
+    // extended instead, or because they're dots that were already drawn
+    struct LineStats {
+        uint64_t coalescedLines{};
+        uint64_t dedupedDots{};
+    };
+    const LineStats& GetLineStats() const { return m_lineStats; }
+
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(m_integratorsEnabled, m_pos, m_lastDrawingEnabled, m_lastDir, m_velocityX,
+               m_velocityY, m_xyOffset, m_brightness, m_blank, m_rampPhase, m_rampDelay);
+    }
+
 private:
+    void UpdateCycle(RenderContext& renderContext);
+    cycles_t StableCycles() const;
+    void UpdateStable(cycles_t cycles, RenderContext& renderContext);
+    void AddLine(const Line& line, RenderContext& renderContext);
+    float LineBrightness() const;
+
     bool m_integratorsEnabled{};
     Vector2 m_pos;
 
@@ -39,4 +63,6 @@ private:
     int32_t m_rampDelay = 0;
 
     float m_brightnessCurve = 0.f; // Set externally
+    bool m_outputEnabled = true;   // Set externally
+    LineStats m_lineStats;
 };
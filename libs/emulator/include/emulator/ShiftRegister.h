@@ -22,6 +22,16 @@ public:
     bool CB2Active() const { return m_cb2Active; }
     void Update(cycles_t cycles);
 
+    // Number of cycles until shifting completes and the interrupt flag is set, or 0 if idle
+    cycles_t CyclesUntilDone() const { return static_cast<cycles_t>(m_shiftCyclesLeft); }
+
+    // Number of cycles until the next bit is output to CB2, or 0 if idle
+    cycles_t CyclesUntilNextOutput() const {
+        if (m_shiftCyclesLeft == 0)
+            return 0;
+        return m_shiftCyclesLeft % 2 == 1 ? 1 : 2;
+    }
+
     void SetInterruptFlag(bool enabled) { m_interruptFlag = enabled; }
     bool InterruptFlag() const { return m_interruptFlag; }
 
@@ -55,6 +55,9 @@ public:
         }
     }
 
+    // Number of cycles until the counter expires (it wraps and expires again every 64K cycles)
+    cycles_t CyclesUntilExpired() const { return m_counter == 0 ? 1 : m_counter; }
+
     void SetInterruptFlag(bool enabled) { m_interruptFlag = enabled; }
     bool InterruptFlag() const { return m_interruptFlag; }
 
@@ -105,6 +108,9 @@ public:
         }
     }
 
+    // Number of cycles until the counter expires (it wraps and expires again every 64K cycles)
+    cycles_t CyclesUntilExpired() const { return m_counter == 0 ? 1 : m_counter; }
+
     void SetInterruptFlag(bool enabled) { m_interruptFlag = enabled; }
     bool InterruptFlag() const { return m_interruptFlag; }
 
@@ -8,6 +8,7 @@
 #include "core/Line.h"
 #include "core/MathUtil.h"
 #include "emulator/Timers.h"
+#include <optional>
 
 class Input;
 struct RenderContext;
@@ -29,17 +30,49 @@ public:
 
     void FrameUpdate(double frameTime);
 
+    // While disabled, no lines or audio samples are output, which is much faster, e.g. to
+    // fast-forward. All other state, including everything visible to the CPU, is updated exactly.
+    // Must be set while synced (between instructions).
+    void SetOutputEnabled(bool enabled);
+
     bool IrqEnabled() const;
     bool FirqEnabled() const;
 
+    // Used to skip over idle loops (see Emulator::SkipIdleCycles)
+    static bool IsInterruptFlagRegister(uint16_t address);
+    // Interrupt flags that raise an IRQ when set
+    uint8_t IrqInterruptFlags() const;
+    // Returns the number of cycles until any of the interrupt flags in mask is set (0 if one
+    // already is), or NoPendingEvent if none will be, assuming no registers are accessed in the
+    // meantime. Returns std::nullopt if it can't be predicted, i.e. for flags raised by input
+    // (CA1).
+    std::optional<cycles_t> CyclesUntilInterruptFlags(uint8_t mask) const;
+
+    // Games pace their frames with Timer2: the BIOS's Wait_Recal waits for it to expire, then
+    // restarts it, usually for 50 Hz. Its expiries are therefore the boundaries between the game's
+    // frames. Returns the number of them so far, and the cycles until the next one, assuming Timer2
+    // isn't restarted in the meantime.
+    uint64_t FrameBoundaryCount() const { return m_frameBoundaryCount; }
+    cycles_t CyclesUntilFrameBoundary() const { return m_timer2.CyclesUntilExpired(); }
+
     Screen& GetScreen() { return m_screen; }
 
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(m_portB, m_portA, m_dataDirB, m_dataDirA, m_periphCntl, m_interruptEnable, m_screen,
+               m_psg, m_timer1, m_timer2, m_shiftRegister, m_joystickButtonState, m_joystickPot,
+               m_ca1Enabled, m_ca1InterruptFlag, m_firqEnabled, m_elapsedAudioCycles,
+               m_directAudioSamples, m_psgAudioSamples);
+    }
+
 private:
     uint8_t Read(uint16_t address) const override;
     void Write(uint16_t address, uint8_t value) override;
     void Sync(cycles_t cycles) override;
+    cycles_t CyclesUntilNextEvent() const override;
     void DoSync(cycles_t cycles, const Input& input, RenderContext& renderContext,
                 AudioContext& audioContext);
+    void UpdateTimersAndScreen(cycles_t cycles, RenderContext& renderContext);
     uint8_t GetInterruptFlagValue() const;
 
     struct SyncContext {
@@ -69,4 +102,6 @@ private:
     float m_elapsedAudioCycles{};
     MathUtil::AverageValue m_directAudioSamples;
     MathUtil::AverageValue m_psgAudioSamples;
+    bool m_outputEnabled = true;       // Not part of the machine's state
+    uint64_t m_frameBoundaryCount = 0; // Not part of the machine's state
 };
@@ -1,15 +1,30 @@
 #include "emulator/BiosRom.h"
+#include "core/Encode.h"
 #include "core/ErrorHandler.h"
 #include "core/Stream.h"
 #include "emulator/MemoryMap.h"
 
 void BiosRom::Init(MemoryBus& memoryBus) {
-    memoryBus.ConnectDevice(*this, MemoryMap::Bios.range, EnableSync::False);
+    m_memoryBus = &memoryBus;
+    m_memoryBus->ConnectDevice(*this, MemoryMap::Bios.range, EnableSync::False);
+    UpdateDirectMemory();
 }
 
 bool BiosRom::LoadBiosRom(const char* file) {
     FileStream fs(file, "rb");
-    return fs.Read(&m_data[0], m_data.size());
+    bool result = fs.Read(&m_data[0], m_data.size());
+    // Contents changed, so anything cached from it (e.g. decoded instructions) is now stale
+    UpdateDirectMemory();
+    return result;
+}
+
+uint32_t BiosRom::Hash() const {
+    return Encode::Crc32(0, m_data.data(), m_data.size());
+}
+
+void BiosRom::UpdateDirectMemory() {
+    m_memoryBus->SetDirectMemory(*this, m_data.data(), m_data.size(),
+                                 static_cast<uint16_t>(m_data.size() - 1), DirectAccess::ReadOnly);
 }
 
 uint8_t BiosRom::Read(uint16_t address) const {
@@ -1,5 +1,6 @@
 #include "emulator/Cartridge.h"
 #include "core/ConsoleOutput.h"
+#include "core/Encode.h"
 #include "core/ErrorHandler.h"
 #include "core/Stream.h"
 #include "emulator/MemoryMap.h"
@@ -71,19 +72,26 @@ namespace {
 } // namespace
 
 void Cartridge::Init(MemoryBus& memoryBus) {
-    memoryBus.ConnectDevice(*this, MemoryMap::Cartridge.range, EnableSync::False);
+    m_memoryBus = &memoryBus;
+    m_memoryBus->ConnectDevice(*this, MemoryMap::Cartridge.range, EnableSync::False);
     m_data.resize(MemoryMap::Cartridge.physicalSize, 0);
+    UpdateDirectMemory();
 }
 
 bool Cartridge::LoadRom(const char* file) {
     if (IsValidRom(file)) {
         FileStream fs(file, "rb");
         m_data = ReadStreamUntilEnd(fs);
+        UpdateDirectMemory();
         return true;
     }
     return false;
 }
 
+uint32_t Cartridge::Hash() const {
+    return Encode::Crc32(0, m_data.data(), m_data.size());
+}
+
 uint8_t Cartridge::Read(uint16_t address) const {
     auto mappedAddress = MemoryMap::Cartridge.MapAddress(address);
     if (mappedAddress >= m_data.size()) {
@@ -96,6 +104,13 @@ uint8_t Cartridge::Read(uint16_t address) const {
     return m_data[mappedAddress];
 }
 
+void Cartridge::UpdateDirectMemory() {
+    // Only the pages fully covered by the rom are accessed directly, so that reads past the end
+    // still go through Read.
+    m_memoryBus->SetDirectMemory(*this, m_data.data(), m_data.size(), 0xFFFF,
+                                 DirectAccess::ReadOnly);
+}
+
 void Cartridge::Write(uint16_t /*address*/, uint8_t /*value*/) {
     ErrorHandler::Undefined("Writes to Cartridge ROM not allowed\n");
 }
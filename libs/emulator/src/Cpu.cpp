@@ -4,8 +4,12 @@
 #include "emulator/CpuHelpers.h"
 #include "emulator/CpuOpCodes.h"
 #include "emulator/MemoryBus.h"
+#include "emulator/SaveState.h"
+#include <algorithm>
 #include <array>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace {
     template <typename T>
@@ -69,11 +73,37 @@ public:
     cycles_t m_cycles{};
     bool m_waitingForInterrupts{}; // Set by CWAI
 
-    void Init(MemoryBus& memoryBus) { m_memoryBus = &memoryBus; }
+    // Most ALU ops don't compute their condition code flags right away. Instead, they record their
+    // operands in m_lazyFlags, and the flags are only computed into CC by MaterializeCC, which
+    // must be called before anything reads or directly modifies CC. Since most flags are
+    // overwritten before they're ever read, this saves computing them in the common case.
+    enum class LazyFlagsOp : uint8_t {
+        None,
+        Add8,      // NZVCH = a + b + carry
+        Add16,     // NZVC = a + b + carry
+        Subtract8, // NZVCH = a - b - carry
+        Subtract16,
+        Logical8, // NZ from a, V cleared
+        Logical16,
+        Increment8, // NZV from a + 1
+        Decrement8, // NZV from a - 1
+    };
+    struct LazyFlags {
+        LazyFlagsOp op = LazyFlagsOp::None;
+        uint16_t a{};
+        uint16_t b{};
+        uint16_t carry{};
+    } m_lazyFlags;
+
+    void Init(MemoryBus& memoryBus) {
+        m_memoryBus = &memoryBus;
+        m_decodeCache.resize(0x10000);
+        m_decodeCacheVersion = m_memoryBus->DirectMemoryVersion() - 1; // Force reset
+    }
 
     void AddCycles(cycles_t cycles) {
         m_cycles += cycles;
-        m_memoryBus->AddSyncCycles(cycles);
+        m_memoryBus->AddCycles(cycles);
     }
 
     void Reset() {
@@ -83,6 +113,7 @@ public:
         S = 0; // BIOS will init this to 0xCBEA, which is the last byte of programmer-usable RAM
         DP = 0;
 
+        m_lazyFlags.op = LazyFlagsOp::None;
         CC.Value = 0;
         CC.InterruptMask = 1;
         CC.FastInterruptMask = 1;
@@ -93,12 +124,31 @@ public:
         m_waitingForInterrupts = false;
     }
 
-    uint8_t Read8(uint16_t address) { return m_memoryBus->Read(address); }
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(static_cast<CpuRegisters&>(*this), m_cycles, m_waitingForInterrupts, m_lazyFlags);
+    }
+
+    uint8_t Read8(uint16_t address) {
+        // Fast path for RAM and ROM
+        if (auto page = m_memoryBus->DirectReadPage(address))
+            return page[address % MemoryBus::PageSize];
+        return m_memoryBus->Read(address);
+    }
+
+    void Write8(uint16_t address, uint8_t value) {
+        // Fast path for RAM
+        if (auto page = m_memoryBus->DirectWritePage(address)) {
+            page[address % MemoryBus::PageSize] = value;
+            return;
+        }
+        m_memoryBus->Write(address, value);
+    }
 
     uint16_t Read16(uint16_t address) {
         // Big endian
-        auto high = m_memoryBus->Read(address++);
-        auto low = m_memoryBus->Read(address);
+        auto high = Read8(address++);
+        auto low = Read8(address);
         return CombineToU16(high, low);
     }
 
@@ -109,21 +159,21 @@ public:
         return value;
     }
 
-    void Push8(uint16_t& stackPointer, uint8_t value) { m_memoryBus->Write(--stackPointer, value); }
+    void Push8(uint16_t& stackPointer, uint8_t value) { Write8(--stackPointer, value); }
 
     uint8_t Pop8(uint16_t& stackPointer) {
-        auto value = m_memoryBus->Read(stackPointer++);
+        auto value = Read8(stackPointer++);
         return value;
     }
 
     void Push16(uint16_t& stackPointer, uint16_t value) {
-        m_memoryBus->Write(--stackPointer, U8(value & 0xFF)); // Low
-        m_memoryBus->Write(--stackPointer, U8(value >> 8));   // High
+        Write8(--stackPointer, U8(value & 0xFF)); // Low
+        Write8(--stackPointer, U8(value >> 8));   // High
     }
 
     uint16_t Pop16(uint16_t& stackPointer) {
-        auto high = m_memoryBus->Read(stackPointer++);
-        auto low = m_memoryBus->Read(stackPointer++);
+        auto high = Read8(stackPointer++);
+        auto low = Read8(stackPointer++);
         return CombineToU16(high, low);
     }
 
@@ -138,122 +188,53 @@ public:
         // used in a calculation of the EA. The postbyte specifies type and variation of addressing
         // mode as well as pointer registers to be used.
 
-        auto RegisterSelect = [this](uint8_t postbyte) -> uint16_t& {
-            switch ((postbyte >> 5) & 0b11) {
-            case 0b00:
-                return X;
-            case 0b01:
-                return Y;
-            case 0b10:
-                return U;
-            default: // 0b11:
-                return S;
-            }
-        };
-
-        uint16_t EA = 0;
         uint8_t postbyte = ReadPC8();
-        bool supportsIndirect = true;
-
-        if ((postbyte & BITS(7)) == 0) // (+/- 4 bit offset),R
-        {
-            // postbyte is a 5 bit two's complement number we convert to 8 bit.
-            // So if bit 4 is set (sign bit), we extend the sign bit by turning on bits 6,7,8;
-            int8_t offset = postbyte & 0b0001'1111;
-            if (postbyte & BITS(4))
-                offset |= 0b1110'0000;
-            EA = RegisterSelect(postbyte) + offset;
-            supportsIndirect = false;
-            AddCycles(1);
-        } else {
-            switch (postbyte & 0b1111) {
-            case 0b0000: { // ,R+
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg;
-                reg += 1;
-                supportsIndirect = false;
-                AddCycles(2);
-            } break;
-            case 0b0001: { // ,R++
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg;
-                reg += 2;
-                AddCycles(3);
-            } break;
-            case 0b0010: { // ,-R
-                auto& reg = RegisterSelect(postbyte);
-                reg -= 1;
-                EA = reg;
-                supportsIndirect = false;
-                AddCycles(2);
-            } break;
-            case 0b0011: { // ,--R
-                auto& reg = RegisterSelect(postbyte);
-                reg -= 2;
-                EA = reg;
-                AddCycles(3);
-            } break;
-            case 0b0100: // ,R
-                EA = RegisterSelect(postbyte);
-                break;
-            case 0b0101: // (+/- B),R
-                EA = RegisterSelect(postbyte) + S16(B);
-                AddCycles(1);
-                break;
-            case 0b0110: // (+/- A),R
-                EA = RegisterSelect(postbyte) + S16(A);
-                AddCycles(1);
-                break;
-            case 0b0111:
-                ErrorHandler::Undefined("Illegal indexed instruction post-byte\n");
-                break;
-            case 0b1000: { // (+/- 7 bit offset),R
-                uint8_t postbyte2 = ReadPC8();
-                EA = RegisterSelect(postbyte) + S16(postbyte2);
-                AddCycles(1);
-            } break;
-            case 0b1001: { // (+/- 15 bit offset),R
-                uint8_t postbyte2 = ReadPC8();
-                uint8_t postbyte3 = ReadPC8();
-                EA = RegisterSelect(postbyte) + CombineToS16(postbyte2, postbyte3);
-                AddCycles(4);
-            } break;
-            case 0b1010:
-                ErrorHandler::Undefined("Illegal indexed instruction post-byte\n");
-                break;
-            case 0b1011: // (+/- D),R
-                EA = RegisterSelect(postbyte) + S16(D);
-                AddCycles(4);
-                break;
-            case 0b1100: { // (+/- 7 bit offset),PC
-                uint8_t postbyte2 = ReadPC8();
-                EA = PC + S16(postbyte2);
-                AddCycles(1);
-            } break;
-            case 0b1101: { // (+/- 15 bit offset),PC
-                uint8_t postbyte2 = ReadPC8();
-                uint8_t postbyte3 = ReadPC8();
-                EA = PC + CombineToS16(postbyte2, postbyte3);
-                AddCycles(5);
-            } break;
-            case 0b1110:
-                ErrorHandler::Undefined("Illegal indexed instruction post-byte\n");
-                break;
-            case 0b1111: { // [address] (Indirect-only)
-                uint8_t postbyte2 = ReadPC8();
-                uint8_t postbyte3 = ReadPC8();
-                EA = CombineToS16(postbyte2, postbyte3);
-                AddCycles(2);
-            } break;
-            default:
-                ErrorHandler::Undefined("Illegal indexed instruction post-byte\n");
-                break;
-            }
+        const IndexedPostbyte& mode = LookupIndexedPostbyte(postbyte);
+
+        if (mode.illegal)
+            ErrorHandler::Undefined("Illegal indexed instruction post-byte\n");
+
+        // Offset bytes must be read before PC is used as the base register
+        int16_t offset = 0;
+        switch (mode.offset) {
+        case IndexedPostbyte::Offset::None:
+            break;
+        case IndexedPostbyte::Offset::Constant:
+            offset = mode.constantOffset;
+            break;
+        case IndexedPostbyte::Offset::A:
+            offset = S16(A);
+            break;
+        case IndexedPostbyte::Offset::B:
+            offset = S16(B);
+            break;
+        case IndexedPostbyte::Offset::D:
+            offset = S16(D);
+            break;
+        case IndexedPostbyte::Offset::Immediate8:
+            offset = S16(ReadPC8());
+            break;
+        case IndexedPostbyte::Offset::Immediate16: {
+            uint8_t msb = ReadPC8();
+            uint8_t lsb = ReadPC8();
+            offset = CombineToS16(msb, lsb);
+        } break;
+        }
+
+        uint16_t EA = offset;
+        if (mode.reg != IndexedPostbyte::Register::None) {
+            uint16_t* const indexRegs[]{&X, &Y, &U, &S, &PC};
+            uint16_t& reg = *indexRegs[static_cast<size_t>(mode.reg)];
+            reg += mode.preIncrement;
+            EA += reg;
+            reg += mode.postIncrement;
         }
 
-        if (supportsIndirect && (postbyte & BITS(4))) {
-            uint8_t msb = m_memoryBus->Read(EA);
-            uint8_t lsb = m_memoryBus->Read(EA + 1);
+        AddCycles(mode.cycles);
+
+        if (mode.indirect) {
+            uint8_t msb = Read8(EA);
+            uint8_t lsb = Read8(EA + 1);
             EA = CombineToU16(msb, lsb);
             AddCycles(3);
         }
@@ -305,38 +286,30 @@ public:
     template <int page, uint8_t opCode>
     void OpLD(uint8_t& targetReg) {
         uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
-        CC.Negative = CalcNegative(value);
-        CC.Zero = CalcZero(value);
-        CC.Overflow = 0;
+        SetLazyFlags(LazyFlagsOp::Logical8, value);
         targetReg = value;
     }
 
     template <int page, uint8_t opCode>
     void OpLD(uint16_t& targetReg) {
         uint16_t value = ReadOperandValue16<LookupCpuOp(page, opCode).addrMode>();
-        CC.Negative = CalcNegative(value);
-        CC.Zero = CalcZero(value);
-        CC.Overflow = 0;
+        SetLazyFlags(LazyFlagsOp::Logical16, value);
         targetReg = value;
     }
 
     template <int page, uint8_t opCode>
     void OpST(const uint8_t& sourceReg) {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        m_memoryBus->Write(EA, sourceReg);
-        CC.Negative = CalcNegative(sourceReg);
-        CC.Zero = CalcZero(sourceReg);
-        CC.Overflow = 0;
+        Write8(EA, sourceReg);
+        SetLazyFlags(LazyFlagsOp::Logical8, sourceReg);
     }
 
     template <int page, uint8_t opCode>
     void OpST(const uint16_t& sourceReg) {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        m_memoryBus->Write(EA, U8(sourceReg >> 8));       // High
-        m_memoryBus->Write(EA + 1, U8(sourceReg & 0xFF)); // Low
-        CC.Negative = CalcNegative(sourceReg);
-        CC.Zero = CalcZero(sourceReg);
-        CC.Overflow = 0;
+        Write8(EA, U8(sourceReg >> 8));       // High
+        Write8(EA + 1, U8(sourceReg & 0xFF)); // Low
+        SetLazyFlags(LazyFlagsOp::Logical16, sourceReg);
     }
 
     template <int page, uint8_t opCode>
@@ -345,6 +318,7 @@ public:
         reg = EA;
         // Zero flag not affected by LEAU/LEAS
         if (&reg == &X || &reg == &Y) {
+            MaterializeCC();
             CC.Zero = (reg == 0);
         }
     }
@@ -359,7 +333,8 @@ public:
     template <int page, uint8_t opCode>
     void OpCLR() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        m_memoryBus->Write(EA, 0);
+        Write8(EA, 0);
+        MaterializeCC();
         CC.Negative = 0;
         CC.Zero = 1;
         CC.Overflow = 0;
@@ -368,12 +343,100 @@ public:
 
     void OpCLR(uint8_t& reg) {
         reg = 0;
+        MaterializeCC();
         CC.Negative = 0;
         CC.Zero = 1;
         CC.Overflow = 0;
         CC.Carry = 0;
     }
 
+    // Returns the CC bits set by the given lazy op
+    static constexpr uint8_t LazyFlagsMask(LazyFlagsOp op) {
+        constexpr uint8_t C = BITS(0), V = BITS(1), Z = BITS(2), N = BITS(3), H = BITS(5);
+        switch (op) {
+        case LazyFlagsOp::None:
+            return 0;
+        case LazyFlagsOp::Add8:
+        case LazyFlagsOp::Subtract8:
+            return N | Z | V | C | H;
+        case LazyFlagsOp::Add16:
+        case LazyFlagsOp::Subtract16:
+            return N | Z | V | C;
+        case LazyFlagsOp::Logical8:
+        case LazyFlagsOp::Logical16:
+        case LazyFlagsOp::Increment8:
+        case LazyFlagsOp::Decrement8:
+            return N | Z | V;
+        }
+        return 0;
+    }
+
+    void SetLazyFlags(LazyFlagsOp op, uint16_t a, uint16_t b = 0, uint16_t carry = 0) {
+        // If the pending op sets flags that this one doesn't, those must be computed now
+        if ((LazyFlagsMask(m_lazyFlags.op) & ~LazyFlagsMask(op)) != 0)
+            MaterializeCC();
+        m_lazyFlags = {op, a, b, carry};
+    }
+
+    void MaterializeCC() {
+        const auto& lf = m_lazyFlags;
+        switch (lf.op) {
+        case LazyFlagsOp::None:
+            return;
+        case LazyFlagsOp::Add8:
+            AddImpl(U8(lf.a), U8(lf.b), U8(lf.carry), CC);
+            break;
+        case LazyFlagsOp::Add16:
+            AddImpl(lf.a, lf.b, lf.carry, CC);
+            break;
+        case LazyFlagsOp::Subtract8:
+            SubtractImpl(U8(lf.a), U8(lf.b), U8(lf.carry), CC);
+            break;
+        case LazyFlagsOp::Subtract16:
+            SubtractImpl(lf.a, lf.b, lf.carry, CC);
+            break;
+        case LazyFlagsOp::Logical8:
+            CC.Negative = CalcNegative(U8(lf.a));
+            CC.Zero = CalcZero(U8(lf.a));
+            CC.Overflow = 0;
+            break;
+        case LazyFlagsOp::Logical16:
+            CC.Negative = CalcNegative(lf.a);
+            CC.Zero = CalcZero(lf.a);
+            CC.Overflow = 0;
+            break;
+        case LazyFlagsOp::Increment8:
+            CC.Overflow = lf.a == 0b0111'1111;
+            CC.Zero = CalcZero(U8(lf.a + 1));
+            CC.Negative = CalcNegative(U8(lf.a + 1));
+            break;
+        case LazyFlagsOp::Decrement8:
+            CC.Overflow = lf.a == 0b1000'0000; // Could also set to (value == 0b01111'1111)
+            CC.Zero = CalcZero(U8(lf.a - 1));
+            CC.Negative = CalcNegative(U8(lf.a - 1));
+            break;
+        }
+        m_lazyFlags.op = LazyFlagsOp::None;
+    }
+
+    // Lazy versions of AddImpl and SubtractImpl
+    uint8_t AddLazy(uint8_t a, uint8_t b, uint8_t carry) {
+        SetLazyFlags(LazyFlagsOp::Add8, a, b, carry);
+        return U8(a + b + carry);
+    }
+    uint16_t AddLazy(uint16_t a, uint16_t b, uint16_t carry) {
+        SetLazyFlags(LazyFlagsOp::Add16, a, b, carry);
+        return U16(a + b + carry);
+    }
+    uint8_t SubtractLazy(uint8_t a, uint8_t b, uint8_t carry) {
+        SetLazyFlags(LazyFlagsOp::Subtract8, a, b, carry);
+        return U8(a - b - carry);
+    }
+    uint16_t SubtractLazy(uint16_t a, uint16_t b, uint16_t carry) {
+        SetLazyFlags(LazyFlagsOp::Subtract16, a, b, carry);
+        return U16(a - b - carry);
+    }
+
     static uint8_t AddImpl(uint8_t a, uint8_t b, uint8_t carry, ConditionCode& CC) {
         uint16_t r16 = U16(a) + U16(b) + U16(carry);
         CC.HalfCarry = CalcHalfCarryFromAdd(a, b, carry);
@@ -410,46 +473,49 @@ public:
     template <int page, uint8_t opCode>
     void OpADD(uint8_t& reg) {
         uint8_t b = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
-        reg = AddImpl(reg, b, 0, CC);
+        reg = AddLazy(reg, b, 0);
     }
 
     // ADDD
     template <int page, uint8_t opCode>
     void OpADD(uint16_t& reg) {
         uint16_t b = ReadOperandValue16<LookupCpuOp(page, opCode).addrMode>();
-        reg = AddImpl(reg, b, 0, CC);
+        reg = AddLazy(reg, b, 0);
     }
 
     // ADCA, ADCB
     template <int page, uint8_t opCode>
     void OpADC(uint8_t& reg) {
         uint8_t b = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
-        reg = AddImpl(reg, b, CC.Carry, CC);
+        MaterializeCC();
+        reg = AddLazy(reg, b, CC.Carry);
     }
 
     // SUBA, SUBB
     template <int page, uint8_t opCode>
     void OpSUB(uint8_t& reg) {
-        reg = SubtractImpl(reg, ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>(), 0, CC);
+        reg = SubtractLazy(reg, ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>(), 0);
     }
 
     // SUBD
     template <int page, uint8_t opCode>
     void OpSUB(uint16_t& reg) {
-        reg = SubtractImpl(reg, ReadOperandValue16<LookupCpuOp(page, opCode).addrMode>(), 0, CC);
+        reg = SubtractLazy(reg, ReadOperandValue16<LookupCpuOp(page, opCode).addrMode>(), 0);
     }
 
     // SBCA, SBCB
     template <int page, uint8_t opCode>
     void OpSBC(uint8_t& reg) {
-        reg = SubtractImpl(reg, ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>(), CC.Carry,
-                           CC);
+        uint8_t b = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
+        MaterializeCC();
+        reg = SubtractLazy(reg, b, CC.Carry);
     }
 
     // MUL
     template <int page, uint8_t opCode>
     void OpMUL() {
         uint16_t result = A * B;
+        MaterializeCC();
         CC.Zero = CalcZero(result);
         CC.Carry = TestBits01(result, BITS(7)); // Because bitwise multiply
         D = result;
@@ -458,6 +524,7 @@ public:
     template <int page, uint8_t opCode>
     void OpSEX() {
         A = TestBits(B, BITS(7)) ? 0xFF : 0;
+        MaterializeCC();
         CC.Negative = CalcNegative(D);
         CC.Zero = CalcZero(D);
     }
@@ -466,60 +533,55 @@ public:
     template <int page, uint8_t opCode>
     void OpNEG(uint8_t& value) {
         // Negating is 0 - value
-        value = SubtractImpl(0, value, 0, CC);
+        value = SubtractLazy(uint8_t{0}, value, 0);
     }
 
     // NEG <address>
     template <int page, uint8_t opCode>
     void OpNEG() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpNEG<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     // INCA, INCB
     template <int page, uint8_t opCode>
     void OpINC(uint8_t& value) {
-        uint8_t origValue = value;
+        SetLazyFlags(LazyFlagsOp::Increment8, value);
         ++value;
-        CC.Overflow = origValue == 0b0111'1111;
-        CC.Zero = CalcZero(value);
-        CC.Negative = CalcNegative(value);
     }
 
     // INC <address>
     template <int page, uint8_t opCode>
     void OpINC() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpINC<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     // DECA, DECB
     template <int page, uint8_t opCode>
     void OpDEC(uint8_t& value) {
-        uint8_t origValue = value;
+        SetLazyFlags(LazyFlagsOp::Decrement8, value);
         --value;
-        CC.Overflow = origValue == 0b1000'0000; // Could also set to (value == 0b01111'1111)
-        CC.Zero = CalcZero(value);
-        CC.Negative = CalcNegative(value);
     }
 
     // DEC <address>
     template <int page, uint8_t opCode>
     void OpDEC() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpDEC<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
     void OpASR(uint8_t& value) {
         auto origValue = value;
         value = (origValue & 0b1000'0000) | (value >> 1);
+        MaterializeCC();
         CC.Zero = CalcZero(value);
         CC.Negative = CalcNegative(value);
         CC.Carry = origValue & 0b0000'0001;
@@ -528,15 +590,16 @@ public:
     template <int page, uint8_t opCode>
     void OpASR() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpASR<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
     void OpLSR(uint8_t& value) {
         auto origValue = value;
         value = (value >> 1);
+        MaterializeCC();
         CC.Zero = CalcZero(value);
         CC.Negative = 0; // Bit 7 always shifted out
         CC.Carry = origValue & 0b0000'0001;
@@ -545,13 +608,14 @@ public:
     template <int page, uint8_t opCode>
     void OpLSR() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpLSR<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
     void OpROL(uint8_t& value) {
+        MaterializeCC();
         uint8_t result = (value << 1) | CC.Carry;
         CC.Carry = TestBits01(value, BITS(7));
         //@TODO: Can we use CalcOverflow(value) instead?
@@ -564,13 +628,14 @@ public:
     template <int page, uint8_t opCode>
     void OpROL() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpROL<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
     void OpROR(uint8_t& value) {
+        MaterializeCC();
         uint8_t result = (CC.Carry << 7) | (value >> 1);
         CC.Carry = TestBits01(value, BITS(0));
         CC.Negative = CalcNegative(result);
@@ -581,14 +646,15 @@ public:
     template <int page, uint8_t opCode>
     void OpROR() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpROR<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
     void OpCOM(uint8_t& value) {
         value = ~value;
+        MaterializeCC();
         CC.Negative = CalcNegative(value);
         CC.Zero = CalcZero(value);
         CC.Overflow = 0;
@@ -598,23 +664,23 @@ public:
     template <int page, uint8_t opCode>
     void OpCOM() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpCOM<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
     void OpASL(uint8_t& value) {
         // Shifting left is same as adding value + value (aka value * 2)
-        value = AddImpl(value, value, 0, CC);
+        value = AddLazy(value, value, 0);
     }
 
     template <int page, uint8_t opCode>
     void OpASL() {
         uint16_t EA = ReadEA16<LookupCpuOp(page, opCode).addrMode>();
-        uint8_t value = m_memoryBus->Read(EA);
+        uint8_t value = Read8(EA);
         OpASL<page, opCode>(value);
-        m_memoryBus->Write(EA, value);
+        Write8(EA, value);
     }
 
     template <int page, uint8_t opCode>
@@ -643,8 +709,10 @@ public:
             Push8(stackReg, B);
         if (value & BITS(1))
             Push8(stackReg, A);
-        if (value & BITS(0))
+        if (value & BITS(0)) {
+            MaterializeCC();
             Push8(stackReg, CC.Value);
+        }
 
         // 1 cycle per byte pushed
         AddCycles(NumBitsSet(ReadBits(value, BITS(0, 1, 2, 3))));
@@ -655,8 +723,10 @@ public:
     void OpPUL(uint16_t& stackReg) {
         ASSERT(&stackReg == &S || &stackReg == &U);
         const uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
-        if (value & BITS(0))
+        if (value & BITS(0)) {
+            MaterializeCC();
             CC.Value = Pop8(stackReg);
+        }
         if (value & BITS(1))
             A = Pop8(stackReg);
         if (value & BITS(2))
@@ -681,9 +751,7 @@ public:
 
     template <int page, uint8_t opCode>
     void OpTST(const uint8_t& value) {
-        CC.Negative = CalcNegative(value);
-        CC.Zero = CalcZero(value);
-        CC.Overflow = 0;
+        SetLazyFlags(LazyFlagsOp::Logical8, value);
     }
 
     template <int page, uint8_t opCode>
@@ -694,24 +762,26 @@ public:
     template <int page, uint8_t opCode>
     void OpOR(uint8_t& reg) {
         uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
-        reg = reg | value;
         // For ORCC, we don't update CC. @TODO: separate function?
-        if (&reg != &CC.Value) {
-            CC.Negative = CalcNegative(reg);
-            CC.Zero = CalcZero(reg);
-            CC.Overflow = 0;
+        if (&reg == &CC.Value) {
+            MaterializeCC();
+            reg = reg | value;
+        } else {
+            reg = reg | value;
+            SetLazyFlags(LazyFlagsOp::Logical8, reg);
         }
     }
 
     template <int page, uint8_t opCode>
     void OpAND(uint8_t& reg) {
         uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
-        reg = reg & value;
         // For ANDCC, we don't update CC. @TODO: separate function?
-        if (&reg != &CC.Value) {
-            CC.Negative = CalcNegative(reg);
-            CC.Zero = CalcZero(reg);
-            CC.Overflow = 0;
+        if (&reg == &CC.Value) {
+            MaterializeCC();
+            reg = reg & value;
+        } else {
+            reg = reg & value;
+            SetLazyFlags(LazyFlagsOp::Logical8, reg);
         }
     }
 
@@ -719,9 +789,7 @@ public:
     void OpEOR(uint8_t& reg) {
         uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
         reg ^= value;
-        CC.Negative = CalcNegative(reg);
-        CC.Zero = CalcZero(reg);
-        CC.Overflow = 0;
+        SetLazyFlags(LazyFlagsOp::Logical8, reg);
     }
 
     template <int page, uint8_t opCode>
@@ -734,6 +802,7 @@ public:
     template <int page, uint8_t opCode>
     void OpCWAI() {
         uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
+        MaterializeCC();
         CC.Value = CC.Value & value;
         PushCCState(true);
         ASSERT(!m_waitingForInterrupts);
@@ -744,14 +813,14 @@ public:
     void OpCMP(const uint8_t& reg) {
         // Subtract to update CC, but discard result
         uint8_t discard =
-            SubtractImpl(reg, ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>(), 0, CC);
+            SubtractLazy(reg, ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>(), 0);
         (void)discard;
     }
 
     template <int page, uint8_t opCode>
     void OpCMP(const uint16_t& reg) {
         uint16_t discard =
-            SubtractImpl(reg, ReadOperandValue16<LookupCpuOp(page, opCode).addrMode>(), 0, CC);
+            SubtractLazy(reg, ReadOperandValue16<LookupCpuOp(page, opCode).addrMode>(), 0);
         (void)discard;
     }
 
@@ -759,14 +828,13 @@ public:
     void OpBIT(const uint8_t& reg) {
         uint8_t value = ReadOperandValue8<LookupCpuOp(page, opCode).addrMode>();
         uint8_t result = reg & value;
-        CC.Negative = CalcNegative(result);
-        CC.Zero = CalcZero(result);
-        CC.Overflow = 0;
+        SetLazyFlags(LazyFlagsOp::Logical8, result);
     }
 
     template <typename CondFunc>
     void OpBranch(CondFunc condFunc) {
         int8_t offset = ReadRelativeOffset8();
+        MaterializeCC();
         if (condFunc()) {
             PC += offset;
         }
@@ -775,6 +843,7 @@ public:
     template <typename CondFunc>
     void OpLongBranch(CondFunc condFunc) {
         int16_t offset = ReadRelativeOffset16();
+        MaterializeCC();
         if (condFunc()) {
             PC += offset;
             AddCycles(1); // Extra cycle if branch is taken
@@ -810,6 +879,7 @@ public:
 
         if (postbyte & BITS(3)) {
             ASSERT(src < 4 && dst < 4); // Only first 4 are valid 8-bit register indices
+            MaterializeCC();
             uint8_t* const reg[]{&A, &B, &CC.Value, &DP};
             if (exchange)
                 std::swap(*reg[dst], *reg[src]);
@@ -832,6 +902,7 @@ public:
     void OpABX() { X += B; }
 
     void OpDAA() {
+        MaterializeCC();
         // Extract least and most siginifant nibbles
         uint8_t lsn = A & 0b0000'1111;
         uint8_t msn = (A & 0b1111'0000) >> 4;
@@ -864,6 +935,7 @@ public:
     }
 
     void PushCCState(bool entire) {
+        MaterializeCC();
         CC.Entire = entire ? 1 : 0;
 
         Push16(S, PC);
@@ -877,6 +949,7 @@ public:
     }
 
     void PopCCState(bool& poppedEntire) {
+        MaterializeCC();
         CC.Value = Pop8(S);
         poppedEntire = CC.Entire != 0;
         if (CC.Entire) {
@@ -893,6 +966,61 @@ public:
         //@TODO: CC.Entire = 0; ?
     }
 
+    std::optional<Cpu::IdleLoop> FindIdleLoop() const {
+        // FIRQ is checked on every instruction and isn't supported anyway
+        if (CC.FastInterruptMask == 0)
+            return {};
+
+        if (m_waitingForInterrupts) {
+            // See DoExecuteInstruction
+            Cpu::IdleLoop idleLoop;
+            idleLoop.cyclesPerIteration = 10;
+            idleLoop.lastInstructionCycle = 0;
+            idleLoop.irqMasked = CC.InterruptMask != 0;
+            return idleLoop;
+        }
+
+        // Look for BITA/BITB <address> followed by BEQ back to it. Only code in directly accessed
+        // memory is considered, as reading it has no side effects.
+        uint8_t bytes[5];
+        for (uint16_t i = 0; i < 5; ++i) {
+            const uint16_t address = PC + i;
+            auto page = m_memoryBus->DirectReadPage(address);
+            if (!page)
+                return {};
+            bytes[i] = page[address % MemoryBus::PageSize];
+        }
+
+        const uint8_t opCode = bytes[0];
+        const bool isDirect = opCode == 0x95 || opCode == 0xD5;   // BITA/BITB direct
+        const bool isExtended = opCode == 0xB5 || opCode == 0xF5; // BITA/BITB extended
+        if (!isDirect && !isExtended)
+            return {};
+
+        const CpuOp& bitOp = LookupCpuOp(0, opCode);
+        const uint8_t* beq = bytes + bitOp.size;
+        const int8_t branchBack = -static_cast<int8_t>(bitOp.size + 2);
+        if (beq[0] != 0x27 || static_cast<int8_t>(beq[1]) != branchBack)
+            return {};
+
+        Cpu::IdleLoop idleLoop;
+        idleLoop.cyclesPerIteration = bitOp.cycles + LookupCpuOp(0, 0x27).cycles;
+        idleLoop.lastInstructionCycle = bitOp.cycles;
+        idleLoop.irqMasked = CC.InterruptMask != 0;
+        idleLoop.pollAddress =
+            isDirect ? CombineToU16(DP, bytes[1]) : CombineToU16(bytes[1], bytes[2]);
+        idleLoop.pollMask = (opCode == 0x95 || opCode == 0xB5) ? A : B;
+        return idleLoop;
+    }
+
+    void SkipIdleLoop(const Cpu::IdleLoop& idleLoop, cycles_t iterations) {
+        // Polling loops only modify CC: BIT found no bits set, and BEQ materialized the flags
+        if (idleLoop.pollAddress && iterations > 0) {
+            SetLazyFlags(LazyFlagsOp::Logical8, 0);
+            MaterializeCC();
+        }
+    }
+
     cycles_t ExecuteInstruction(bool irqEnabled, bool firqEnabled) {
         m_cycles = 0;
         DoExecuteInstruction(irqEnabled, firqEnabled);
@@ -900,10 +1028,6 @@ public:
     }
 
     void DoExecuteInstruction(bool irqEnabled, bool firqEnabled) {
-        auto UnhandledOp = [](const CpuOp& cpuOp) {
-            ErrorHandler::Undefined("Unhandled Op: %s\n", cpuOp.name);
-        };
-
         // Just for debugging, keep a copy in case we assert
         const auto currInstructionPC = PC;
         (void)currInstructionPC;
@@ -942,6 +1066,20 @@ public:
             return;
         }
 
+        if (m_decodeCacheVersion != m_memoryBus->DirectMemoryVersion())
+            ResetDecodeCache();
+
+        // Fast path for code in ROM
+        if (m_decodeCacheablePages[PC / MemoryBus::PageSize]) {
+            DecodedOp& decodedOp = m_decodeCache[PC];
+            if (decodedOp.cpuOp || DecodeOp(PC, decodedOp)) {
+                PC += decodedOp.opCodeSize;
+                AddCycles(decodedOp.cpuOp->cycles); // Base cycles for this instruction
+                (this->*decodedOp.handler)();
+                return;
+            }
+        }
+
         // Read op code byte and page
         int cpuOpPage = 0;
         uint8_t opCodeByte = ReadPC8();
@@ -953,7 +1091,7 @@ public:
             opCodeByte = ReadPC8();
         }
 
-        const CpuOp& cpuOp = LookupCpuOpRuntime(cpuOpPage, opCodeByte);
+        const CpuOp& cpuOp = LookupCpuOp(cpuOpPage, opCodeByte);
 
         ASSERT_MSG(cpuOp.cycles >= 0, "TODO: look at how to handle cycles for instruction: %s",
                    cpuOp.name);
@@ -968,9 +1106,21 @@ public:
         ASSERT(cpuOp.addrMode != AddressingMode::Variant &&
                "Page 1/2 instruction, should have read next byte by now");
 
-        switch (cpuOpPage) {
-        case 0:
-            switch (cpuOp.opCode) {
+        // Dispatch to the handler for this op
+        (this->*OpHandlers[cpuOpPage][opCodeByte])();
+    }
+
+    static void UnhandledOp(const CpuOp& cpuOp) {
+        ErrorHandler::Undefined("Unhandled Op: %s\n", cpuOp.name);
+    }
+
+    // Executes the op for the given page and opCode. This is instantiated for every page and
+    // opCode to build the OpHandlers table, and since both are compile-time constants, the
+    // switches below reduce to a single call to the op's implementation.
+    template <int page, uint8_t opCode>
+    void ExecuteOp() {
+        if constexpr (page == 0) {
+            switch (opCode) {
             case 0x3E:
                 OpRESET();
                 break;
@@ -1696,12 +1846,11 @@ public:
                 break;
 
             default:
-                UnhandledOp(cpuOp);
+                UnhandledOp(LookupCpuOp(page, opCode));
             }
-            break;
 
-        case 1:
-            switch (cpuOp.opCode) {
+        } else if constexpr (page == 1) {
+            switch (opCode) {
             case 0x3F:
                 OpSWI(InterruptVector::Swi2);
                 break;
@@ -1825,12 +1974,11 @@ public:
                 break;
 
             default:
-                UnhandledOp(cpuOp);
+                UnhandledOp(LookupCpuOp(page, opCode));
             }
-            break;
 
-        case 2:
-            switch (cpuOp.opCode) {
+        } else if constexpr (page == 2) {
+            switch (opCode) {
             case 0x3F:
                 OpSWI(InterruptVector::Swi3);
                 break;
@@ -1862,11 +2010,71 @@ public:
                 break;
 
             default:
-                UnhandledOp(cpuOp);
+                UnhandledOp(LookupCpuOp(page, opCode));
             }
-            break;
         }
     }
+
+    // Illegal and page 1/2 variant ops are handled before dispatch
+    void ExecuteIllegalOp() { FAIL_MSG("Illegal op should not be dispatched"); }
+
+    using OpHandler = void (CpuImpl::*)();
+    using OpHandlerTable = std::array<std::array<OpHandler, 256>, 3>;
+    static const OpHandlerTable OpHandlers;
+
+    // Decoded instruction cache for code in read-only memory (BIOS and cartridge ROM), keyed by
+    // PC. Only the op code (and page prefix) is cached: operands are still read via PC, which for
+    // ROM is a direct memory read. Code in RAM always goes through the normal decode path.
+    struct DecodedOp {
+        const CpuOp* cpuOp{}; // nullptr if not decoded yet
+        OpHandler handler{};
+        uint8_t opCodeSize{}; // Number of op code bytes, including page prefix
+    };
+    std::vector<DecodedOp> m_decodeCache;
+    std::array<bool, MemoryBus::NumPages> m_decodeCacheablePages{};
+    uint32_t m_decodeCacheVersion{};
+
+    // Only pages that are read directly and can't be written (ROM) can be cached. Direct access is
+    // disabled while memory bus callbacks are registered (e.g. by the debugger), so that every
+    // instruction fetch is still seen by them.
+    bool IsDecodeCacheablePage(uint16_t address) const {
+        return m_memoryBus->DirectReadPage(address) && !m_memoryBus->DirectWritePage(address);
+    }
+
+    void ResetDecodeCache() {
+        std::fill(m_decodeCache.begin(), m_decodeCache.end(), DecodedOp{});
+        for (size_t page = 0; page < MemoryBus::NumPages; ++page) {
+            m_decodeCacheablePages[page] =
+                IsDecodeCacheablePage(static_cast<uint16_t>(page * MemoryBus::PageSize));
+        }
+        m_decodeCacheVersion = m_memoryBus->DirectMemoryVersion();
+    }
+
+    // Decodes the op at address into decodedOp. Returns false if it can't be cached, in which case
+    // it must be executed through the normal path (e.g. illegal ops).
+    bool DecodeOp(uint16_t address, DecodedOp& decodedOp) {
+        int cpuOpPage = 0;
+        uint8_t opCodeSize = 1;
+        uint8_t opCodeByte = Read8(address);
+        if (IsOpCodePage1(opCodeByte) || IsOpCodePage2(opCodeByte)) {
+            cpuOpPage = IsOpCodePage1(opCodeByte) ? 1 : 2;
+            const uint16_t nextAddress = address + 1;
+            if (!m_decodeCacheablePages[nextAddress / MemoryBus::PageSize])
+                return false;
+            opCodeByte = Read8(nextAddress);
+            opCodeSize = 2;
+        }
+
+        const CpuOp& cpuOp = LookupCpuOp(cpuOpPage, opCodeByte);
+        if (cpuOp.cycles < 0 || cpuOp.addrMode == AddressingMode::Illegal ||
+            cpuOp.addrMode == AddressingMode::Variant)
+            return false;
+
+        decodedOp.cpuOp = &cpuOp;
+        decodedOp.handler = OpHandlers[cpuOpPage][opCodeByte];
+        decodedOp.opCodeSize = opCodeSize;
+        return true;
+    }
 };
 
 template <>
@@ -1892,6 +2100,29 @@ uint8_t CpuImpl::ReadOperandValue8<AddressingMode::Immediate>() {
     return ReadPC8();
 }
 
+namespace {
+    template <int page, uint8_t opCode>
+    constexpr CpuImpl::OpHandler MakeOpHandler() {
+        constexpr auto addrMode = LookupCpuOp(page, opCode).addrMode;
+        if constexpr (addrMode == AddressingMode::Illegal || addrMode == AddressingMode::Variant) {
+            return &CpuImpl::ExecuteIllegalOp;
+        } else {
+            return &CpuImpl::ExecuteOp<page, opCode>;
+        }
+    }
+
+    template <int page, size_t... opCodes>
+    constexpr std::array<CpuImpl::OpHandler, 256> MakeOpHandlers(std::index_sequence<opCodes...>) {
+        return {MakeOpHandler<page, static_cast<uint8_t>(opCodes)>()...};
+    }
+} // namespace
+
+const CpuImpl::OpHandlerTable CpuImpl::OpHandlers = {
+    MakeOpHandlers<0>(std::make_index_sequence<256>{}),
+    MakeOpHandlers<1>(std::make_index_sequence<256>{}),
+    MakeOpHandlers<2>(std::make_index_sequence<256>{}),
+};
+
 Cpu::Cpu() = default;
 Cpu::~Cpu() = default;
 
@@ -1907,6 +2138,28 @@ cycles_t Cpu::ExecuteInstruction(bool irqEnabled, bool firqEnabled) {
     return m_impl->ExecuteInstruction(irqEnabled, firqEnabled);
 }
 
+std::optional<Cpu::IdleLoop> Cpu::FindIdleLoop() const {
+    return m_impl->FindIdleLoop();
+}
+
+void Cpu::SkipIdleLoop(const IdleLoop& idleLoop, cycles_t iterations) {
+    m_impl->SkipIdleLoop(idleLoop, iterations);
+}
+
 const CpuRegisters& Cpu::Registers() const {
+    // Computing pending lazy flags doesn't change the CPU's observable state
+    const_cast<CpuImpl&>(*m_impl).MaterializeCC();
     return *m_impl;
 }
+
+uint16_t Cpu::PC() const {
+    return m_impl->PC;
+}
+
+void Cpu::Serialize(StateWriter& stream) {
+    m_impl->Serialize(stream);
+}
+
+void Cpu::Serialize(StateReader& stream) {
+    m_impl->Serialize(stream);
+}
@@ -1,4 +1,7 @@
 #include "emulator/Emulator.h"
+#include "emulator/Profiler.h"
+#include "emulator/SaveState.h"
+#include <algorithm>
 
 void Emulator::Init(const char* biosRomFile) {
     // TODO: config option
@@ -21,8 +24,11 @@ void Emulator::Init(const char* biosRomFile) {
 
 void Emulator::Reset() {
     // Some games rely on initial random state of memory (e.g. Mine Storm)
-    const unsigned int seed = std::random_device{}();
-    m_ram.Randomize(seed);
+    Reset(std::random_device{}());
+}
+
+void Emulator::Reset(unsigned int ramSeed) {
+    m_ram.Randomize(ramSeed);
 
     m_cpu.Reset();
     m_via.Reset();
@@ -38,6 +44,8 @@ bool Emulator::LoadRom(const char* file) {
 
 cycles_t Emulator::ExecuteInstruction(const Input& input, RenderContext& renderContext,
                                       AudioContext& audioContext) {
+    Profiler::ScopedSection profile(Profiler::Section::Cpu);
+
     m_via.SetSyncContext(input, renderContext, audioContext);
 
     cycles_t cpuCycles = m_cpu.ExecuteInstruction(m_via.IrqEnabled(), m_via.FirqEnabled());
@@ -48,6 +56,159 @@ cycles_t Emulator::ExecuteInstruction(const Input& input, RenderContext& renderC
     return cpuCycles;
 }
 
+cycles_t Emulator::SkipIdleCycles(cycles_t cyclesLeft, const Input& input,
+                                  RenderContext& renderContext, AudioContext& audioContext) {
+    Profiler::ScopedSection profile(Profiler::Section::Cpu);
+
+    const auto idleLoop = m_cpu.FindIdleLoop();
+    if (!idleLoop)
+        return 0;
+
+    // Bring the VIA up to date before looking at its timers
+    m_via.SetSyncContext(input, renderContext, audioContext);
+    m_memoryBus.Sync();
+
+    // Interrupt flags that end the loop
+    uint8_t interruptFlags = idleLoop->irqMasked ? 0 : m_via.IrqInterruptFlags();
+    if (idleLoop->pollAddress) {
+        if (!Via::IsInterruptFlagRegister(*idleLoop->pollAddress))
+            return 0;
+        interruptFlags |= idleLoop->pollMask;
+    }
+
+    const auto cyclesUntilInterrupt = m_via.CyclesUntilInterruptFlags(interruptFlags);
+    if (!cyclesUntilInterrupt)
+        return 0;
+
+    // Number of iterations whose last instruction starts before the given cycle
+    auto IterationsBefore = [&](cycles_t cycles) -> cycles_t {
+        if (cycles <= idleLoop->lastInstructionCycle)
+            return 0;
+        return (cycles - idleLoop->lastInstructionCycle + idleLoop->cyclesPerIteration - 1) /
+               idleLoop->cyclesPerIteration;
+    };
+
+    // Skip iterations that would be executed before the caller stops, and in which the CPU would
+    // not yet see the interrupt flags set.
+    cycles_t iterations = IterationsBefore(cyclesLeft);
+    if (*cyclesUntilInterrupt != IMemoryBusDevice::NoPendingEvent)
+        iterations = std::min(iterations, IterationsBefore(*cyclesUntilInterrupt));
+    if (iterations == 0)
+        return 0;
+
+    m_cpu.SkipIdleLoop(*idleLoop, iterations);
+
+    // Advance no further than the next device event at a time, as the CPU would
+    const cycles_t cycles = iterations * idleLoop->cyclesPerIteration;
+    for (cycles_t remaining = cycles; remaining > 0;) {
+        const cycles_t untilEvent = m_memoryBus.NextEventCycle() - m_memoryBus.Cycles();
+        const cycles_t span = std::min(remaining, std::max<cycles_t>(untilEvent, 1));
+        m_memoryBus.AddCycles(span);
+        remaining -= span;
+    }
+    m_memoryBus.Sync();
+
+    return cycles;
+}
+
+Emulator::RunResult Emulator::RunCycles(cycles_t cycles, const Input& input,
+                                        RenderContext& renderContext, AudioContext& audioContext,
+                                        const InstructionBreakpoints* breakpoints) {
+    RunResult result;
+
+    // Idle loops could contain breakpoints
+    const bool skipIdle = !breakpoints || breakpoints->none();
+
+    m_via.SetSyncContext(input, renderContext, audioContext);
+
+    bool inputSynced = false;
+    while (result.cycles < cycles) {
+        if (breakpoints && breakpoints->test(m_cpu.PC())) {
+            result.breakpointHit = true;
+            break;
+        }
+
+        cycles_t elapsed = 0;
+        if (skipIdle) {
+            elapsed = SkipIdleCycles(cycles - result.cycles, input, renderContext, audioContext);
+        }
+
+        if (elapsed == 0) {
+            Profiler::ScopedSection profile(Profiler::Section::Cpu);
+
+            elapsed = m_cpu.ExecuteInstruction(m_via.IrqEnabled(), m_via.FirqEnabled());
+            ++result.instructions;
+
+            // The first sync applies the new input to the VIA, which ExecuteInstruction does after
+            // the first instruction. After that, input doesn't change, so syncing only when
+            // devices are accessed or have a pending event gives the same results.
+            if (!inputSynced) {
+                m_memoryBus.Sync();
+                inputSynced = true;
+            }
+        } else {
+            inputSynced = true; // SkipIdleCycles syncs
+        }
+
+        result.cycles += elapsed;
+    }
+
+    m_memoryBus.Sync();
+    return result;
+}
+
 void Emulator::FrameUpdate(double frameTime) {
     m_via.FrameUpdate(frameTime);
 }
+
+namespace {
+    struct StateHeader {
+        static constexpr uint32_t ExpectedMagic = 0x53535856; // "VXSS"
+        static constexpr uint32_t CurrentVersion = 1;         // Bump when the layout changes
+
+        uint32_t magic{};
+        uint32_t version{};
+        uint32_t size{};
+    };
+} // namespace
+
+template <typename Stream>
+void Emulator::Serialize(Stream& stream) {
+    stream(m_cpu, m_via, m_ram, m_memoryBus);
+}
+
+size_t Emulator::StateSize() const {
+    StateWriter sizeCounter{nullptr, 0};
+    const_cast<Emulator&>(*this).Serialize(sizeCounter); // Nothing is modified when saving
+    return sizeof(StateHeader) + sizeCounter.Offset();
+}
+
+bool Emulator::SaveState(uint8_t* data, size_t size) const {
+    const size_t stateSize = StateSize();
+    if (size < stateSize)
+        return false;
+
+    const StateHeader header{StateHeader::ExpectedMagic, StateHeader::CurrentVersion,
+                             static_cast<uint32_t>(stateSize)};
+    std::memcpy(data, &header, sizeof(header));
+
+    StateWriter writer{data + sizeof(header), size - sizeof(header)};
+    const_cast<Emulator&>(*this).Serialize(writer); // Nothing is modified when saving
+    return true;
+}
+
+bool Emulator::LoadState(const uint8_t* data, size_t size) {
+    const size_t stateSize = StateSize();
+    if (size < stateSize)
+        return false;
+
+    StateHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != StateHeader::ExpectedMagic ||
+        header.version != StateHeader::CurrentVersion || header.size != stateSize)
+        return false;
+
+    StateReader reader{data + sizeof(header), size - sizeof(header)};
+    Serialize(reader);
+    return true;
+}
@@ -0,0 +1,168 @@
+#include "emulator/Movie.h"
+#include "core/Stream.h"
+
+namespace {
+    constexpr uint32_t ExpectedMagic = 0x564D5856; // "VXMV"
+    constexpr uint32_t CurrentVersion = 1;         // Bump when the format changes
+} // namespace
+
+void Movie::BeginRecording(const Header& header) {
+    m_header = header;
+    m_numFrames = 0;
+    m_playedFrames = 0;
+    m_frameTimes = {};
+    m_inputs = {};
+}
+
+void Movie::RecordFrame(double frameTime, const Input& input) {
+    m_frameTimes.Record(frameTime);
+    m_inputs.Record(ToInputValue(input));
+    ++m_numFrames;
+}
+
+void Movie::BeginPlayback() {
+    m_playedFrames = 0;
+    m_frameTimes.BeginPlayback();
+    m_inputs.BeginPlayback();
+}
+
+bool Movie::PlayFrame(double& frameTime, Input& input) {
+    if (m_playedFrames == m_numFrames)
+        return false;
+
+    InputValue inputValue;
+    m_frameTimes.Play(frameTime);
+    m_inputs.Play(inputValue);
+    input = ToInput(inputValue);
+    ++m_playedFrames;
+    return true;
+}
+
+// Values are written field by field so that the format doesn't depend on struct padding
+bool Movie::Save(const char* file) const {
+    FileStream fs;
+    if (!fs.Open(file, "wb"))
+        return false;
+
+    bool result = fs.WriteValue(ExpectedMagic) == 1 && fs.WriteValue(CurrentVersion) == 1 &&
+                  fs.WriteValue(m_header.ramSeed) == 1 && fs.WriteValue(m_header.biosHash) == 1 &&
+                  fs.WriteValue(m_header.romHash) == 1 &&
+                  fs.WriteValue(m_header.instructionHash) == 1 &&
+                  fs.WriteValue(static_cast<uint32_t>(m_numFrames)) == 1;
+
+    result = result && fs.WriteValue(static_cast<uint32_t>(m_frameTimes.runs.size())) == 1;
+    for (auto& run : m_frameTimes.runs) {
+        result = result && fs.WriteValue(run.count) == 1 && fs.WriteValue(run.value) == 1;
+    }
+
+    result = result && fs.WriteValue(static_cast<uint32_t>(m_inputs.runs.size())) == 1;
+    for (auto& run : m_inputs.runs) {
+        result = result && fs.WriteValue(run.count) == 1 &&
+                 fs.WriteValue(run.value.buttons) == 1 &&
+                 fs.Write(run.value.axes.data(), run.value.axes.size()) == run.value.axes.size();
+    }
+
+    return result;
+}
+
+bool Movie::Load(const char* file) {
+    FileStream fs;
+    if (!fs.Open(file, "rb"))
+        return false;
+
+    uint32_t magic{};
+    uint32_t version{};
+    if (!fs.ReadValue(magic) || magic != ExpectedMagic || !fs.ReadValue(version) ||
+        version != CurrentVersion)
+        return false;
+
+    Header header;
+    uint32_t numFrames{};
+    if (!fs.ReadValue(header.ramSeed) || !fs.ReadValue(header.biosHash) ||
+        !fs.ReadValue(header.romHash) || !fs.ReadValue(header.instructionHash) ||
+        !fs.ReadValue(numFrames))
+        return false;
+
+    // Each track must add up to the number of frames
+    auto ReadRuns = [&](auto& track, auto ReadValue) {
+        uint32_t numRuns{};
+        if (!fs.ReadValue(numRuns))
+            return false;
+        track.runs.resize(numRuns);
+        size_t trackFrames = 0;
+        for (auto& run : track.runs) {
+            if (!fs.ReadValue(run.count) || run.count == 0 || !ReadValue(run.value))
+                return false;
+            trackFrames += run.count;
+        }
+        return trackFrames == numFrames;
+    };
+
+    Track<double> frameTimes;
+    Track<InputValue> inputs;
+    const bool result =
+        ReadRuns(frameTimes, [&](double& value) { return fs.ReadValue(value); }) &&
+        ReadRuns(inputs, [&](InputValue& value) {
+            return fs.ReadValue(value.buttons) && fs.Read(value.axes.data(), value.axes.size());
+        });
+    if (!result)
+        return false;
+
+    m_header = header;
+    m_numFrames = numFrames;
+    m_frameTimes = std::move(frameTimes);
+    m_inputs = std::move(inputs);
+    BeginPlayback();
+    return true;
+}
+
+template <typename T>
+void Movie::Track<T>::Record(const T& value) {
+    if (!runs.empty() && runs.back().value == value && runs.back().count < UINT32_MAX) {
+        ++runs.back().count;
+    } else {
+        runs.push_back({1, value});
+    }
+}
+
+template <typename T>
+void Movie::Track<T>::BeginPlayback() {
+    currRun = 0;
+    currRunFrame = 0;
+}
+
+template <typename T>
+bool Movie::Track<T>::Play(T& value) {
+    if (currRun == runs.size())
+        return false;
+
+    value = runs[currRun].value;
+    if (++currRunFrame == runs[currRun].count) {
+        ++currRun;
+        currRunFrame = 0;
+    }
+    return true;
+}
+
+Movie::InputValue Movie::ToInputValue(const Input& input) {
+    InputValue value;
+    value.buttons = input.ButtonStateMask();
+    for (int i = 0; i < 4; ++i) {
+        value.axes[i] = input.AnalogStateMask(i);
+    }
+    return value;
+}
+
+Input Movie::ToInput(const InputValue& value) {
+    Input input;
+    for (uint8_t joystickIndex = 0; joystickIndex < 2; ++joystickIndex) {
+        for (uint8_t buttonIndex = 0; buttonIndex < 4; ++buttonIndex) {
+            const uint8_t mask = 1 << (buttonIndex + joystickIndex * 4);
+            // Bits are on if not pressed
+            input.SetButton(joystickIndex, buttonIndex, (value.buttons & mask) == 0);
+        }
+        input.SetAnalogAxisX(joystickIndex, value.axes[joystickIndex * 2 + 0]);
+        input.SetAnalogAxisY(joystickIndex, value.axes[joystickIndex * 2 + 1]);
+    }
+    return input;
+}
@@ -3,6 +3,8 @@
 #include "core/ErrorHandler.h"
 #include "core/Gui.h"
 #include "emulator/EngineTypes.h"
+#include "emulator/SaveState.h"
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <memory>
@@ -112,6 +114,19 @@ namespace {
             return false;
         }
 
+        // Clocks the timer multiple times, returning true if it expired on the last clock. Must not
+        // be clocked past its next expiry.
+        bool Clock(uint32_t clocks) {
+            if (m_period == 0)
+                return false;
+            assert(clocks > 0 && clocks <= ClocksUntilExpired());
+            m_time += clocks - 1;
+            return Clock();
+        }
+
+        // Number of clocks until the timer next expires
+        uint32_t ClocksUntilExpired() const { return m_period - m_time; }
+
     private:
         uint32_t m_period{};
         uint32_t m_time{}; // Time in period
@@ -352,6 +367,11 @@ namespace {
             return 1.f / ::powf(::sqrtf(2), 15.f - volume);
         }
 
+        template <typename Stream>
+        void Serialize(Stream& stream) {
+            stream(m_mode, m_fixedVolume);
+        }
+
     private:
         AmplitudeMode m_mode = AmplitudeMode::Fixed;
         uint32_t m_fixedVolume{};
@@ -414,6 +434,11 @@ namespace {
             return finalSample;
         }
 
+        template <typename Stream>
+        void Serialize(Stream& stream) {
+            stream(m_toneEnabled, m_noiseEnabled, m_amplitudeControl);
+        }
+
     private:
         bool m_toneEnabled{};
         bool m_noiseEnabled{};
@@ -439,13 +464,25 @@ public:
 
     void Reset();
     void Update(cycles_t cycles);
+    cycles_t CyclesUntilOutputChange() const;
 
     float Sample() const;
 
     void FrameUpdate(double frameTime);
 
+    template <typename Stream>
+    void Serialize(Stream& stream) {
+        stream(m_mode, m_BDIR, m_BC1, m_DA, m_latchedAddress, m_registers, m_masterDivider,
+               m_toneGenerators, m_noiseGenerator, m_envelopeGenerator);
+        for (auto& channel : m_channels) {
+            stream(channel);
+        }
+    }
+
 private:
     void Clock();
+    void UpdateMode();
+    void ClockGenerators();
 
     uint8_t Read(uint16_t address);
     void Write(uint16_t address, uint8_t value);
@@ -458,6 +495,13 @@ private:
         LatchAddress // BDIR on  BC1 on
     };
 
+    static PsgMode ModeFromBDIRandBC1(bool BDIR, bool BC1) {
+        uint8_t value{};
+        SetBits(value, 0b10, BDIR);
+        SetBits(value, 0b01, BC1);
+        return static_cast<PsgMode>(value);
+    }
+
     PsgMode m_mode = PsgMode::Inactive;
 
     bool m_BDIR{};
@@ -500,11 +544,34 @@ void PsgImpl::Reset() {
 }
 
 void PsgImpl::Update(cycles_t cycles) {
-    for (cycles_t cycle = 0; cycle < cycles; ++cycle) {
-        Clock();
+    if (cycles == 0)
+        return;
+
+    // BDIR and BC1 can't change during an update, so only the first clock can latch an address, or
+    // read or write a register. After that, only the master divider needs to be clocked until it
+    // expires.
+    Clock();
+
+    cycles_t cyclesLeft = cycles - 1;
+    while (cyclesLeft > 0) {
+        const auto clocks = static_cast<uint32_t>(
+            std::min<cycles_t>(cyclesLeft, m_masterDivider.ClocksUntilExpired()));
+        if (m_masterDivider.Clock(clocks)) {
+            ClockGenerators();
+        }
+        cyclesLeft -= clocks;
     }
 }
 
+cycles_t PsgImpl::CyclesUntilOutputChange() const {
+    // Next clock will change mode, which may write a register
+    if (ModeFromBDIRandBC1(m_BDIR, m_BC1) != m_mode)
+        return 0;
+
+    // Otherwise, output only changes when the generators are clocked
+    return m_masterDivider.ClocksUntilExpired() - 1;
+}
+
 void PsgImpl::FrameUpdate(double frameTime) {
     // Debug output
     static bool PsgImGui = false;
@@ -589,13 +656,15 @@ void PsgImpl::FrameUpdate(double frameTime) {
 }
 
 void PsgImpl::Clock() {
-    auto ModeFromBDIRandBC1 = [](bool BDIR, bool BC1) -> PsgImpl::PsgMode {
-        uint8_t value{};
-        SetBits(value, 0b10, BDIR);
-        SetBits(value, 0b01, BC1);
-        return static_cast<PsgImpl::PsgMode>(value);
-    };
+    UpdateMode();
+
+    // Clock generators every 16 input clocks
+    if (m_masterDivider.Clock()) {
+        ClockGenerators();
+    }
+}
 
+void PsgImpl::UpdateMode() {
     const auto lastMode = m_mode;
     m_mode = ModeFromBDIRandBC1(m_BDIR, m_BC1);
 
@@ -618,15 +687,14 @@ void PsgImpl::Clock() {
         }
         break;
     }
+}
 
-    // Clock generators every 16 input clocks
-    if (m_masterDivider.Clock()) {
-        for (auto& toneGenerator : m_toneGenerators) {
-            toneGenerator.Clock();
-        }
-        m_noiseGenerator.Clock();
-        m_envelopeGenerator.Clock();
+void PsgImpl::ClockGenerators() {
+    for (auto& toneGenerator : m_toneGenerators) {
+        toneGenerator.Clock();
     }
+    m_noiseGenerator.Clock();
+    m_envelopeGenerator.Clock();
 }
 
 float PsgImpl::Sample() const {
@@ -773,6 +841,10 @@ void Psg::Update(cycles_t cycles) {
     m_impl->Update(cycles);
 }
 
+cycles_t Psg::CyclesUntilOutputChange() const {
+    return m_impl->CyclesUntilOutputChange();
+}
+
 float Psg::Sample() const {
     return m_impl->Sample();
 }
@@ -780,3 +852,11 @@ float Psg::Sample() const {
 void Psg::FrameUpdate(double frameTime) {
     return m_impl->FrameUpdate(frameTime);
 }
+
+void Psg::Serialize(StateWriter& stream) {
+    m_impl->Serialize(stream);
+}
+
+void Psg::Serialize(StateReader& stream) {
+    m_impl->Serialize(stream);
+}
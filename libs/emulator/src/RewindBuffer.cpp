@@ -0,0 +1,205 @@
+#include "emulator/RewindBuffer.h"
+#include "core/ErrorHandler.h"
+#include <algorithm>
+#include <cstring>
+
+// Deltas are a sequence of tokens, each made of a 16 bit count of unchanged bytes to skip, and a
+// 16 bit count of literal bytes to XOR into the state, followed by the literal bytes.
+namespace {
+    constexpr size_t MaxRunLength = 0xFFFF;
+    constexpr size_t TokenHeaderSize = 4;
+
+    // Runs of unchanged bytes shorter than this are cheaper to store as literals than to start a
+    // new token for
+    constexpr size_t MinZeroRunLength = TokenHeaderSize;
+
+    size_t MaxDeltaSize(size_t stateSize) {
+        // Worst case: tokens of 1 literal followed by the shortest zero run
+        return stateSize + TokenHeaderSize * (stateSize / (MinZeroRunLength + 1) + 2);
+    }
+
+    void Write16(uint8_t* out, size_t value) {
+        out[0] = static_cast<uint8_t>(value & 0xFF);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    size_t Read16(const uint8_t* in) { return in[0] | (in[1] << 8); }
+} // namespace
+
+void RewindBuffer::Init(size_t stateSize, size_t memoryBudget, size_t maxFrames,
+                        size_t keyframeInterval) {
+    m_stateSize = stateSize;
+    m_keyframeInterval = keyframeInterval;
+
+    m_frames.assign(maxFrames, {});
+    m_lastState.assign(stateSize, 0);
+    m_encodeBuffer.assign(MaxDeltaSize(stateSize), 0);
+
+    const size_t bookkeepingSize =
+        m_frames.size() * sizeof(FrameRecord) + m_lastState.size() + m_encodeBuffer.size();
+    ASSERT_MSG(memoryBudget > bookkeepingSize + stateSize * keyframeInterval,
+               "Rewind buffer memory budget is too small");
+    m_data.assign(memoryBudget - bookkeepingSize, 0);
+
+    Clear();
+}
+
+void RewindBuffer::Clear() {
+    m_dataEnd = 0;
+    m_firstFrame = 0;
+    m_numFrames = 0;
+    m_framesSinceKeyframe = 0;
+}
+
+void RewindBuffer::Push(const uint8_t* state) {
+    bool keyframe = m_numFrames == 0 || m_framesSinceKeyframe + 1 >= m_keyframeInterval;
+
+    const uint8_t* data = state;
+    size_t size = m_stateSize;
+    if (!keyframe) {
+        data = m_encodeBuffer.data();
+        size = EncodeDelta(state, m_lastState.data(), m_encodeBuffer.data());
+    }
+
+    // Make room, making sure we don't discard the state the delta is against
+    uint32_t offset{};
+    while (m_numFrames == m_frames.size() || !Allocate(size, offset)) {
+        DiscardOldestKeyframe();
+        if (m_numFrames == 0 && !keyframe) {
+            keyframe = true;
+            data = state;
+            size = m_stateSize;
+        }
+    }
+
+    std::memcpy(m_data.data() + offset, data, size);
+    m_frames[(m_firstFrame + m_numFrames) % m_frames.size()] =
+        FrameRecord{offset, static_cast<uint32_t>(size), keyframe};
+    ++m_numFrames;
+    m_dataEnd = offset + static_cast<uint32_t>(size);
+
+    m_framesSinceKeyframe = keyframe ? 0 : m_framesSinceKeyframe + 1;
+    std::copy(state, state + m_stateSize, m_lastState.begin());
+}
+
+bool RewindBuffer::Peek(size_t framesBack, uint8_t* state) const {
+    if (framesBack >= m_numFrames)
+        return false;
+
+    // The first frame is always a keyframe
+    const size_t target = m_numFrames - 1 - framesBack;
+    size_t keyframe = target;
+    while (!Frame(keyframe).keyframe)
+        --keyframe;
+
+    std::memcpy(state, m_data.data() + Frame(keyframe).offset, m_stateSize);
+    for (size_t i = keyframe + 1; i <= target; ++i) {
+        ApplyDelta(m_data.data() + Frame(i).offset, Frame(i).size, state);
+    }
+    return true;
+}
+
+bool RewindBuffer::Rewind(size_t framesBack, uint8_t* state) {
+    if (!Peek(framesBack, state))
+        return false;
+
+    m_numFrames -= framesBack;
+    const auto& lastFrame = Frame(m_numFrames - 1);
+    m_dataEnd = lastFrame.offset + lastFrame.size;
+
+    m_framesSinceKeyframe = 0;
+    for (size_t i = m_numFrames - 1; !Frame(i).keyframe; --i)
+        ++m_framesSinceKeyframe;
+
+    std::copy(state, state + m_stateSize, m_lastState.begin());
+    return true;
+}
+
+size_t RewindBuffer::EncodeDelta(const uint8_t* state, const uint8_t* prevState,
+                                 uint8_t* out) const {
+    auto Changed = [&](size_t i) { return state[i] != prevState[i]; };
+
+    size_t outSize = 0;
+    size_t i = 0;
+    while (i < m_stateSize) {
+        const size_t zeroStart = i;
+        while (i < m_stateSize && i - zeroStart < MaxRunLength && !Changed(i))
+            ++i;
+        const size_t numZeros = i - zeroStart;
+
+        // Literals run until the next long enough run of unchanged bytes
+        const size_t literalStart = i;
+        while (i < m_stateSize && i - literalStart < MaxRunLength) {
+            if (Changed(i)) {
+                ++i;
+                continue;
+            }
+            size_t zeroEnd = i;
+            while (zeroEnd < m_stateSize && zeroEnd - i < MinZeroRunLength && !Changed(zeroEnd))
+                ++zeroEnd;
+            if (zeroEnd - i >= MinZeroRunLength || zeroEnd == m_stateSize)
+                break;
+            i = std::min(zeroEnd, literalStart + MaxRunLength);
+        }
+        const size_t numLiterals = i - literalStart;
+
+        Write16(out + outSize, numZeros);
+        Write16(out + outSize + 2, numLiterals);
+        outSize += TokenHeaderSize;
+        for (size_t j = literalStart; j < i; ++j) {
+            out[outSize++] = state[j] ^ prevState[j];
+        }
+    }
+
+    ASSERT(outSize <= m_encodeBuffer.size());
+    return outSize;
+}
+
+void RewindBuffer::ApplyDelta(const uint8_t* delta, size_t deltaSize, uint8_t* state) const {
+    size_t stateOffset = 0;
+    for (size_t i = 0; i < deltaSize;) {
+        stateOffset += Read16(delta + i);
+        const size_t numLiterals = Read16(delta + i + 2);
+        i += TokenHeaderSize;
+
+        for (size_t j = 0; j < numLiterals; ++j) {
+            state[stateOffset++] ^= delta[i++];
+        }
+    }
+}
+
+bool RewindBuffer::Allocate(size_t size, uint32_t& offset) const {
+    if (m_numFrames == 0) {
+        offset = 0;
+        return size <= m_data.size();
+    }
+
+    // Live data starts at the first frame's offset, and ends at m_dataEnd, possibly wrapping
+    // around. We never let m_dataEnd catch up to the start, so that it's unambiguous.
+    const uint32_t start = Frame(0).offset;
+    if (m_dataEnd > start) {
+        if (m_dataEnd + size <= m_data.size()) {
+            offset = m_dataEnd;
+            return true;
+        }
+        if (size < start) {
+            offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    if (m_dataEnd + size < start) {
+        offset = m_dataEnd;
+        return true;
+    }
+    return false;
+}
+
+void RewindBuffer::DiscardOldestKeyframe() {
+    // Deltas up to the next keyframe can't be decoded without it
+    do {
+        m_firstFrame = (m_firstFrame + 1) % m_frames.size();
+        --m_numFrames;
+    } while (m_numFrames > 0 && !Frame(0).keyframe);
+}
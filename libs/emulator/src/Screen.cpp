@@ -1,6 +1,9 @@
 #include "emulator/Screen.h"
 #include "core/Gui.h"
 #include "emulator/EngineTypes.h"
+#include "emulator/Profiler.h"
+#include <algorithm>
+#include <limits>
 
 namespace {
     //@TODO: make these conditionally const for "shipping" build
@@ -11,6 +14,36 @@ namespace {
     // that go outside the 256x256 grid. So we scale down the line drawing values a little to make
     // it fit within the grid again.
     float LineDrawScale = 0.85f;
+    // How far, in screen units, merged lines may be from the ones they replace. Merging only drops
+    // repeated dots, and lines collinear with the previous one, so a fraction of a pixel is enough.
+    float LineMergeTolerance = 0.05f;
+
+    enum class MergeResult { None, Coalesced, DedupedDot };
+
+    // Merges line into prev if drawing prev alone looks the same as drawing both
+    MergeResult MergeLines(Line& prev, const Line& line, float tolerance) {
+        if (prev.brightness != line.brightness)
+            return MergeResult::None;
+
+        // Dots are drawn as squares that stick out of the ends of lines, so they're only dropped
+        // if they repeat a dot
+        const bool prevIsDot = prev.p0 == prev.p1;
+        const bool lineIsDot = line.p0 == line.p1;
+        if (prevIsDot && lineIsDot && Magnitude(line.p0 - prev.p0) <= tolerance)
+            return MergeResult::DedupedDot;
+        if (prevIsDot || lineIsDot)
+            return MergeResult::None;
+
+        // Lines that start where prev ends, and continue forward along it, extend it
+        const Vector2 prevDir = prev.p1 - prev.p0;
+        const float prevLength = Magnitude(prevDir);
+        if (Magnitude(line.p0 - prev.p1) > tolerance || Dot(prevDir, line.p1 - prev.p1) <= 0.f ||
+            std::abs(Cross(prevDir, line.p1 - prev.p0)) > tolerance * prevLength) {
+            return MergeResult::None;
+        }
+        prev.p1 = line.p1;
+        return MergeResult::Coalesced;
+    }
 } // namespace
 
 void Screen::Init() {
@@ -18,8 +51,23 @@ void Screen::Init() {
 }
 
 void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
-    m_velocityX.Update(cycles);
-    m_velocityY.Update(cycles);
+    // Cycles on which the velocity or ramp phase change are stepped individually. In between, the
+    // beam moves at a constant velocity, so we can update many cycles at once.
+    while (cycles > 0) {
+        UpdateCycle(renderContext);
+        --cycles;
+
+        const cycles_t stableCycles = std::min(cycles, StableCycles());
+        if (stableCycles > 0) {
+            UpdateStable(stableCycles, renderContext);
+            cycles -= stableCycles;
+        }
+    }
+}
+
+void Screen::UpdateCycle(RenderContext& renderContext) {
+    m_velocityX.Update(1);
+    m_velocityY.Update(1);
 
     // Handle switching to RampUp/RampDown
     switch (m_rampPhase) {
@@ -68,7 +116,7 @@ void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
     case RampPhase::RampOn: {
         const auto offset = Vector2{m_xyOffset, m_xyOffset};
         Vector2 velocity{m_velocityX, m_velocityY};
-        Vector2 delta = (velocity + offset) / 128.f * static_cast<float>(cycles) * LineDrawScale;
+        Vector2 delta = (velocity + offset) / 128.f * LineDrawScale;
         m_pos += delta;
         break;
     }
@@ -80,19 +128,13 @@ void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
 
     // We might draw even when integrators are disabled (e.g. drawing dots)
     bool drawingEnabled = !m_blank && (m_brightness > 0.f && m_brightness <= 128.f);
-    if (drawingEnabled) {
+    if (drawingEnabled && m_outputEnabled) {
         if (m_lastDrawingEnabled && (Magnitude(m_lastDir) > 0.f) && (m_lastDir == currDir) &&
-            !renderContext.lines.empty()) {
-            renderContext.lines.back().p1 = m_pos;
+            !renderContext.lines.Empty()) {
+            renderContext.lines.SetBackEnd(m_pos);
         } else {
-            auto lerp = [](float a, float b, float t) { return a + t * (b - a); };
-            auto easeOut = [](float v) { return 1.f - powf(1.f - v, 5); };
-
-            // Lerp between the linear brightness value and an ease out curve based on the user-set
-            // brightness curve value.
-            float b = m_brightness / 128.f;
-            b = lerp(b, easeOut(b), m_brightnessCurve);
-            renderContext.lines.emplace_back(Line{lastPos, m_pos, b});
+            Profiler::ScopedSection profile(Profiler::Section::RenderContext);
+            AddLine(Line{lastPos, m_pos, LineBrightness()}, renderContext);
         }
     }
 
@@ -100,6 +142,111 @@ void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
     m_lastDir = currDir;
 }
 
+cycles_t Screen::StableCycles() const {
+    // Number of cycles after UpdateCycle that won't change velocity, ramp phase or drawing state
+    cycles_t cycles = std::numeric_limits<cycles_t>::max();
+
+    for (auto velocity : {&m_velocityX, &m_velocityY}) {
+        if (auto updateCycles = velocity->CyclesUntilUpdate(); updateCycles > 0) {
+            cycles = std::min(cycles, updateCycles - 1);
+        }
+    }
+
+    switch (m_rampPhase) {
+    case RampPhase::RampUp:
+    case RampPhase::RampDown:
+        cycles = std::min(cycles, static_cast<cycles_t>(std::max(m_rampDelay - 1, 0)));
+        break;
+
+    case RampPhase::RampOff:
+    case RampPhase::RampOn:
+        break;
+    }
+
+    return cycles;
+}
+
+void Screen::UpdateStable(cycles_t cycles, RenderContext& renderContext) {
+    m_velocityX.Update(cycles);
+    m_velocityY.Update(cycles);
+
+    switch (m_rampPhase) {
+    case RampPhase::RampUp:
+    case RampPhase::RampDown:
+        m_rampDelay -= static_cast<int32_t>(cycles);
+        break;
+
+    case RampPhase::RampOff:
+    case RampPhase::RampOn:
+        break;
+    }
+
+    const bool moving =
+        m_rampPhase == RampPhase::RampOn || m_rampPhase == RampPhase::RampDown;
+    const auto offset = Vector2{m_xyOffset, m_xyOffset};
+    const Vector2 velocity{m_velocityX, m_velocityY};
+    const Vector2 delta = moving ? (velocity + offset) / 128.f * LineDrawScale : Vector2{};
+
+    // Drawing and direction are the same as on the last cycle. If we're drawing in a direction,
+    // we extend the last line; otherwise each cycle adds a new line (e.g. dots).
+    // Note that we accumulate the position per cycle rather than multiplying delta by cycles, so
+    // that we get exactly the same floating point results as updating 1 cycle at a time.
+    const bool extendLine = m_outputEnabled && m_lastDrawingEnabled &&
+                            (Magnitude(m_lastDir) > 0.f) && !renderContext.lines.Empty();
+
+    if (!m_outputEnabled || !m_lastDrawingEnabled || extendLine) {
+        if (moving) {
+            for (cycles_t i = 0; i < cycles; ++i) {
+                m_pos += delta;
+            }
+        }
+        if (extendLine) {
+            renderContext.lines.SetBackEnd(m_pos);
+        }
+    } else {
+        const float b = LineBrightness();
+        Profiler::ScopedSection profile(Profiler::Section::RenderContext);
+        for (cycles_t i = 0; i < cycles; ++i) {
+            const auto lastPos = m_pos;
+            if (moving) {
+                m_pos += delta;
+            }
+            AddLine(Line{lastPos, m_pos, b}, renderContext);
+        }
+    }
+}
+
+void Screen::AddLine(const Line& line, RenderContext& renderContext) {
+    // The last line can't be extended anymore once another one starts, so that's when it's merged
+    // into the one before it
+    auto& lines = renderContext.lines;
+    if (lines.Size() >= 2) {
+        const size_t prevIndex = lines.Size() - 2;
+        Line prev = lines.Get(prevIndex);
+        const auto result = MergeLines(prev, lines.Back(), LineMergeTolerance);
+        if (result != MergeResult::None) {
+            lines.Set(prevIndex, prev);
+            lines.PopBack();
+            if (result == MergeResult::Coalesced)
+                ++m_lineStats.coalescedLines;
+            else
+                ++m_lineStats.dedupedDots;
+        }
+    }
+    lines.PushBack(line);
+}
+
+float Screen::LineBrightness() const {
+    auto lerp = [](float a, float b, float t) { return a + t * (b - a); };
+    auto easeOut = [](float v) { return 1.f - powf(1.f - v, 5); };
+
+    // Lerp between the linear brightness value and an ease out curve based on the user-set
+    // brightness curve value.
+    float b = m_brightness / 128.f;
+    b = lerp(b, easeOut(b), m_brightnessCurve);
+    return b;
+}
+
 void Screen::FrameUpdate(double /*frameTime*/) {
     static bool ScreenImGui = false;
     IMGUI_CALL(Debug, ImGui::Checkbox("<<< Screen >>>", &ScreenImGui));
@@ -109,6 +256,8 @@ void Screen::FrameUpdate(double /*frameTime*/) {
     IMGUI_CALL_IF(ScreenImGui, Debug, ImGui::SliderInt("VelocityXDelay", &VelocityXDelay, 0, 30));
     IMGUI_CALL_IF(ScreenImGui, Debug,
                   ImGui::SliderFloat("LineDrawScale", &LineDrawScale, 0.1f, 1.f));
+    IMGUI_CALL_IF(ScreenImGui, Debug,
+                  ImGui::SliderFloat("LineMergeTolerance", &LineMergeTolerance, 0.f, 1.f));
     m_velocityX.CyclesToUpdateValue = VelocityXDelay;
 }
 
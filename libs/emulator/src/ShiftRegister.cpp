@@ -15,27 +15,26 @@ uint8_t ShiftRegister::ReadValue() const {
 }
 
 void ShiftRegister::Update(cycles_t cycles) {
-    for (int i = 0; i < cycles; ++i) {
-        if (m_shiftCyclesLeft > 0) {
-            if (m_shiftCyclesLeft % 2 == 1) {
-                bool isLastShiftCycle = m_shiftCyclesLeft == 1;
-                if (isLastShiftCycle) {
-                    // For the last (9th) shift cycle, we output the same bit that was output for
-                    // the 8th, which is now in bit position 0. We also don't shift (is that
-                    // correct?)
-                    uint8_t bit = TestBits01(m_value, BITS(0));
-                    m_cb2Active = bit == 0;
-                } else {
-                    uint8_t bit = TestBits01(m_value, BITS(7));
-                    m_cb2Active = bit == 0;
-                    m_value = (m_value << 1) | bit;
-                }
+    // Nothing to do once we're done shifting
+    for (cycles_t i = 0; i < cycles && m_shiftCyclesLeft > 0; ++i) {
+        if (m_shiftCyclesLeft % 2 == 1) {
+            bool isLastShiftCycle = m_shiftCyclesLeft == 1;
+            if (isLastShiftCycle) {
+                // For the last (9th) shift cycle, we output the same bit that was output for
+                // the 8th, which is now in bit position 0. We also don't shift (is that
+                // correct?)
+                uint8_t bit = TestBits01(m_value, BITS(0));
+                m_cb2Active = bit == 0;
+            } else {
+                uint8_t bit = TestBits01(m_value, BITS(7));
+                m_cb2Active = bit == 0;
+                m_value = (m_value << 1) | bit;
             }
-            --m_shiftCyclesLeft;
-
-            // Interrupt enable once we're done shifting
-            if (m_shiftCyclesLeft == 0)
-                m_interruptFlag = true;
         }
+        --m_shiftCyclesLeft;
+
+        // Interrupt enable once we're done shifting
+        if (m_shiftCyclesLeft == 0)
+            m_interruptFlag = true;
     }
 }
@@ -3,6 +3,7 @@
 #include "core/ErrorHandler.h"
 #include "emulator/EngineTypes.h"
 #include "emulator/MemoryMap.h"
+#include "emulator/Profiler.h"
 
 namespace {
     namespace Register {
@@ -139,6 +140,7 @@ void Via::Reset() {
     m_interruptEnable = 0;
 
     m_screen = Screen{};
+    m_screen.SetOutputEnabled(m_outputEnabled);
     m_psg.Reset();
     m_timer1 = Timer1{};
     m_timer2 = Timer2{};
@@ -155,6 +157,8 @@ void Via::Reset() {
 
 void Via::DoSync(cycles_t cycles, const Input& input, RenderContext& renderContext,
                  AudioContext& audioContext) {
+    Profiler::ScopedSection profile(Profiler::Section::Via);
+
     // Update cached input state
     m_joystickButtonState = input.ButtonStateMask();
 
@@ -176,64 +180,130 @@ void Via::DoSync(cycles_t cycles, const Input& input, RenderContext& renderConte
     m_firqEnabled = input.IsButtonDown(0, 3);
 
     // Audio update
-    for (cycles_t i = 0; i < cycles; ++i) {
-        m_psg.Update(1);
-        m_psgAudioSamples.Add(m_psg.Sample());
+    // The PSG's output only changes when its generators are clocked, so we sample it once per span
+    // of cycles that it stays constant. We still accumulate one sample per cycle so that averages
+    // are computed exactly as they would be cycle by cycle.
+    {
+        Profiler::ScopedSection profilePsg(Profiler::Section::Psg);
+        if (!m_outputEnabled)
+            m_psg.Update(cycles);
+
+        for (cycles_t cyclesLeft = m_outputEnabled ? cycles : 0; cyclesLeft > 0;) {
+            m_psg.Update(1);
+            const float psgCycleSample = m_psg.Sample();
+
+            const cycles_t span = std::min(cyclesLeft, 1 + m_psg.CyclesUntilOutputChange());
+            m_psg.Update(span - 1);
 
-        if (++m_elapsedAudioCycles >= audioContext.CpuCyclesPerAudioSample) {
-            m_elapsedAudioCycles -= audioContext.CpuCyclesPerAudioSample;
+            for (cycles_t i = 0; i < span; ++i) {
+                m_psgAudioSamples.Add(psgCycleSample);
 
-            // Need a target sample...
+                if (++m_elapsedAudioCycles >= audioContext.CpuCyclesPerAudioSample) {
+                    m_elapsedAudioCycles -= audioContext.CpuCyclesPerAudioSample;
 
-            float psgSample = m_psgAudioSamples.AverageAndReset();
-            float directSample = m_directAudioSamples.AverageAndReset();
+                    // Need a target sample...
 
-            //@TODO: Is this right? Averaging means getting half the volume when only one source is
-            // playing, which is most of the time.
-            float targetSample = directSample != 0 ? directSample : psgSample;
-            // float targetSample = (psgSample + directSample) / 2.f;
+                    float psgSample = m_psgAudioSamples.AverageAndReset();
+                    float directSample = m_directAudioSamples.AverageAndReset();
 
-            audioContext.samples.push_back(targetSample);
+                    //@TODO: Is this right? Averaging means getting half the volume when only one
+                    // source is playing, which is most of the time.
+                    float targetSample = directSample != 0 ? directSample : psgSample;
+                    // float targetSample = (psgSample + directSample) / 2.f;
+
+                    audioContext.samples.push_back(targetSample);
+                }
+            }
+
+            cyclesLeft -= span;
         }
     }
 
-    //@TODO: Move this code into a Clock() function and call it cycles number of times
-    // For cycle-accurate drawing, we update our timers, shift register, and beam movement 1 cycle
-    // at a time
-    cycles_t cyclesLeft = cycles;
-    cycles = 1;
-    while (cyclesLeft-- > 0) {
-        m_timer1.Update(cycles);
-        m_timer2.Update(cycles);
-        m_shiftRegister.Update(cycles);
-
-        // Shift register's CB2 line drives /BLANK
+    // The lines driving the screen only change when Timer1 expires (if PB7 drives /RAMP), or when
+    // the shift register outputs a bit (if CB2 drives /BLANK). We update the timers and shift
+    // register in spans that end on the next such change, so that the screen sees exactly the same
+    // line states, cycle by cycle, as it would if we stepped 1 cycle at a time.
+    for (cycles_t cyclesLeft = cycles; cyclesLeft > 0;) {
+        cycles_t span = cyclesLeft;
+        if (m_timer1.PB7Flag()) {
+            span = std::min(span, m_timer1.CyclesUntilExpired());
+        }
         if (m_shiftRegister.Mode() == ShiftRegisterMode::ShiftOutUnder02) {
-            m_screen.SetBlankEnabled(m_shiftRegister.CB2Active());
+            if (auto shiftCycles = m_shiftRegister.CyclesUntilNextOutput(); shiftCycles > 0) {
+                span = std::min(span, shiftCycles);
+            }
         }
 
-        // If the Timer1 PB7 flag is set, then PB7 drives /RAMP
-        if (m_timer1.PB7Flag()) {
-            SetBits(m_portB, PortB::RampDisabled, !m_timer1.PB7SignalLow());
+        // Cycles before the change
+        if (span > 1) {
+            UpdateTimersAndScreen(span - 1, renderContext);
         }
 
-        if (PeriphCntl::IsZeroEnabled(m_periphCntl)) {
-            m_screen.ZeroBeam();
-        }
+        // Cycle on which the change occurs
+        UpdateTimersAndScreen(1, renderContext);
+
+        cyclesLeft -= span;
+    }
+}
+
+void Via::UpdateTimersAndScreen(cycles_t cycles, RenderContext& renderContext) {
+    m_timer1.Update(cycles);
+    const bool timer2Expired = m_timer2.InterruptFlag();
+    m_timer2.Update(cycles);
+    if (!timer2Expired && m_timer2.InterruptFlag())
+        ++m_frameBoundaryCount;
+    m_shiftRegister.Update(cycles);
+
+    // Shift register's CB2 line drives /BLANK
+    if (m_shiftRegister.Mode() == ShiftRegisterMode::ShiftOutUnder02) {
+        m_screen.SetBlankEnabled(m_shiftRegister.CB2Active());
+    }
 
-        // Integrators are enabled while RAMP line is active (low)
-        m_screen.SetIntegratorsEnabled(!TestBits(m_portB, PortB::RampDisabled));
+    // If the Timer1 PB7 flag is set, then PB7 drives /RAMP
+    if (m_timer1.PB7Flag()) {
+        SetBits(m_portB, PortB::RampDisabled, !m_timer1.PB7SignalLow());
+    }
+
+    // Integrators are enabled while RAMP line is active (low)
+    m_screen.SetIntegratorsEnabled(!TestBits(m_portB, PortB::RampDisabled));
 
-        // Update screen, which populates the lines in the renderContext
+    // Update screen, which populates the lines in the renderContext. While /ZERO is active, the
+    // beam is zeroed on every cycle.
+    Profiler::ScopedSection profileScreen(Profiler::Section::Screen);
+    if (PeriphCntl::IsZeroEnabled(m_periphCntl)) {
+        for (cycles_t i = 0; i < cycles; ++i) {
+            m_screen.ZeroBeam();
+            m_screen.Update(1, renderContext);
+        }
+    } else {
         m_screen.Update(cycles, renderContext);
     }
 }
 
+cycles_t Via::CyclesUntilNextEvent() const {
+    // Interrupt flags are only raised by the timers expiring and the shift register completing
+    cycles_t cycles = std::min(m_timer1.CyclesUntilExpired(), m_timer2.CyclesUntilExpired());
+    if (auto shiftCycles = m_shiftRegister.CyclesUntilDone(); shiftCycles > 0) {
+        cycles = std::min(cycles, shiftCycles);
+    }
+    return cycles;
+}
+
 void Via::FrameUpdate(double frameTime) {
     m_screen.FrameUpdate(frameTime);
     m_psg.FrameUpdate(frameTime);
 }
 
+void Via::SetOutputEnabled(bool enabled) {
+    // Don't average audio from before output was disabled into the next sample
+    if (enabled && !m_outputEnabled) {
+        m_directAudioSamples.Reset();
+        m_psgAudioSamples.Reset();
+    }
+    m_outputEnabled = enabled;
+    m_screen.SetOutputEnabled(enabled);
+}
+
 uint8_t Via::Read(uint16_t address) const {
     const uint16_t index = MemoryMap::Via.MapAddress(address);
     switch (index) {
@@ -528,6 +598,35 @@ bool Via::FirqEnabled() const {
     return m_firqEnabled;
 }
 
+bool Via::IsInterruptFlagRegister(uint16_t address) {
+    return MemoryMap::IsInRange(address, MemoryMap::Via.range) &&
+           MemoryMap::Via.MapAddress(address) == Register::InterruptFlag;
+}
+
+uint8_t Via::IrqInterruptFlags() const {
+    return m_interruptEnable & 0x7F;
+}
+
+std::optional<cycles_t> Via::CyclesUntilInterruptFlags(uint8_t mask) const {
+    if ((GetInterruptFlagValue() & mask) != 0)
+        return 0;
+
+    if (TestBits(mask, InterruptFlag::CA1))
+        return {};
+
+    // CA2, CB1 and CB2 are never set
+    cycles_t cycles = NoPendingEvent;
+    if (TestBits(mask, InterruptFlag::Timer1))
+        cycles = std::min(cycles, m_timer1.CyclesUntilExpired());
+    if (TestBits(mask, InterruptFlag::Timer2))
+        cycles = std::min(cycles, m_timer2.CyclesUntilExpired());
+    if (TestBits(mask, InterruptFlag::Shift)) {
+        if (auto shiftCycles = m_shiftRegister.CyclesUntilDone(); shiftCycles > 0)
+            cycles = std::min(cycles, shiftCycles);
+    }
+    return cycles;
+}
+
 uint8_t Via::GetInterruptFlagValue() const {
     uint8_t result = 0;
     SetBits(result, InterruptFlag::CA1, m_ca1InterruptFlag);
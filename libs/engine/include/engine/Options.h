@@ -3,10 +3,13 @@
 #include "core/FileSystem.h"
 #include <cassert>
 #include <map>
+#include <mutex>
 #include <string>
 #include <variant>
 #include <vector>
 
+// Options are shared between the engine's render and emulation threads, so all accesses are
+// synchronized
 class Options {
 public:
     using OptionType =
@@ -16,6 +19,7 @@ public:
     // Make sure to add options before loading file
     template <typename T>
     void Add(const char* name, T defaultValue = {}) {
+        std::lock_guard<std::mutex> lock(m_mutex);
         m_options[name] = defaultValue;
     }
 
@@ -25,6 +29,7 @@ public:
 
     template <typename T>
     T Get(const char* name) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
         if (auto iter = m_options.find(name); iter != m_options.end()) {
             return std::get<T>(iter->second);
         }
@@ -34,6 +39,7 @@ public:
 
     template <typename T>
     void Set(const char* name, T value) {
+        std::lock_guard<std::mutex> lock(m_mutex);
         auto iter = m_options.find(name);
         assert(iter != m_options.end());
         iter->second = value;
@@ -42,4 +48,5 @@ public:
 private:
     std::map<std::string, OptionType> m_options;
     fs::path m_filePath;
+    mutable std::mutex m_mutex;
 };
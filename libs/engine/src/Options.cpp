@@ -93,6 +93,7 @@ namespace {
 void Options::Load() {
     assert(!m_filePath.empty());
     std::ifstream fin(m_filePath);
+    std::unique_lock<std::mutex> lock(m_mutex);
     if (!fin) {
         std::cerr << "No options file \"" << m_filePath << "\" found, using default values"
                   << std::endl;
@@ -113,6 +114,7 @@ void Options::Load() {
         }
         fin.close();
     }
+    lock.unlock();
 
     // Always write out options file with default/loaded values
     Save();
@@ -120,6 +122,7 @@ void Options::Load() {
 
 void Options::Save() {
     assert(!m_filePath.empty());
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::ofstream fout(m_filePath);
     for (auto& [name, option] : m_options) {
         auto s = ToString(option);
@@ -1,19 +1,65 @@
 #include "null_engine/NullEngine.h"
+#include "core/ImageUtil.h"
 #include "engine/EngineUtil.h"
 #include "engine/Paths.h"
+#include "soft_render/SoftCrtRender.h"
+#include "soft_render/SoftRender.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace {
     IEngineClient* g_client = nullptr;
-}
+
+    // Value following option in args, if any
+    std::optional<std::string> GetOptionValue(const std::vector<std::string_view>& args,
+                                              std::string_view option) {
+        auto iter = std::find(args.begin(), args.end(), option);
+        if (iter == args.end() || ++iter == args.end())
+            return {};
+        return std::string(*iter);
+    }
+} // namespace
 
 void NullEngine::RegisterClient(IEngineClient& client) {
     g_client = &client;
 }
 
+// Headless: lines are only drawn if -softrender <w>x<h> is passed, in which case -screenshot <file>
+// saves the last frame when the engine exits, after -frames <n> frames. With -crt, frames are drawn
+// with SoftCrtRender instead, which also applies GLRender's glow, decay and overlay.
 bool NullEngine::Run(int argc, char** argv) {
     if (!EngineUtil::FindAndSetRootPath(fs::path(fs::absolute(argv[0]))))
         return false;
 
+    const auto args = std::vector<std::string_view>(argv + 1, argv + argc);
+
+    std::optional<SoftRender> softRender;
+    std::optional<SoftCrtRender> crtRender;
+    if (auto size = GetOptionValue(args, "-softrender")) {
+        int width{}, height{};
+        if (sscanf(size->c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            fprintf(stderr, "Invalid -softrender size: %s\n", size->c_str());
+            return false;
+        }
+        if (std::find(args.begin(), args.end(), "-crt") != args.end()) {
+            crtRender.emplace();
+            crtRender->Init(width, height);
+        } else {
+            softRender.emplace();
+            softRender->Init(width, height);
+        }
+    }
+
+    uint64_t maxFrames = 0; // Run until the client quits
+    if (auto frames = GetOptionValue(args, "-frames"))
+        maxFrames = std::strtoull(frames->c_str(), nullptr, 10);
+
+    const auto screenshotFile = GetOptionValue(args, "-screenshot");
+
     std::shared_ptr<IEngineService> engineService =
         std::make_shared<aggregate_adapter<IEngineService>>(
             // SetFocusMainWindow
@@ -21,26 +67,70 @@ bool NullEngine::Run(int argc, char** argv) {
             // SetFocusConsole
             [] {},
             // ResetOverlay
-            [](const char* /*file*/) {});
+            [&crtRender](const char* file) {
+                if (!crtRender)
+                    return;
+                if (!file) {
+                    crtRender->SetOverlay(nullptr, 0, 0);
+                } else if (!crtRender->LoadOverlay(file)) {
+                    fprintf(stderr, "Failed to load overlay: %s\n", file);
+                    crtRender->SetOverlay(nullptr, 0, 0);
+                }
+            });
 
-    if (!g_client->Init(engineService, Paths::biosRomFile.string(), argc, argv)) {
+    if (!g_client->Init(args, engineService, Paths::biosRomFile.string())) {
         return false;
     }
 
-    bool quit = false;
-    while (!quit) {
+    // Options the client reads every frame
+    Options options;
+    options.Add<float>("brightnessCurve", 0.0f);
+    options.Add<int>("runAheadFrames", 0);
+
+    const float CpuCyclesPerAudioSample = 1'500'000.f / 44'100.f;
+    AudioContext audioContext{CpuCyclesPerAudioSample};
+
+    // Reused, so that line storage doesn't need to grow again every frame
+    RenderContext renderContext;
+
+    for (uint64_t frame = 0; maxFrames == 0 || frame < maxFrames; ++frame) {
         double frameTime = 1.0 / 60;
         EmuEvents emuEvents{};
-        Options options{};
         Input input{};
-        RenderContext renderContext{};
-        AudioContext audioContext{0};
+        renderContext.lines.Clear();
+        renderContext.emulatedTime = 0;
 
         if (!g_client->FrameUpdate(frameTime, {std::ref(emuEvents), std::ref(options)}, input,
                                    renderContext, audioContext)) {
-            quit = true;
+            break;
+        }
+
+        if (softRender) {
+            softRender->Clear();
+            softRender->DrawLines(renderContext.lines);
+        } else if (crtRender) {
+            crtRender->Render(frameTime, renderContext.lines);
+        }
+        audioContext.samples.clear();
+    }
+
+    g_client->Shutdown();
+
+    if ((softRender || crtRender) && screenshotFile) {
+        const int width = softRender ? softRender->Width() : crtRender->Width();
+        const int height = softRender ? softRender->Height() : crtRender->Height();
+        const int numChannels = softRender ? 1 : 3;
+        std::vector<uint8_t> image(static_cast<size_t>(width) * height * numChannels);
+        if (softRender)
+            softRender->ToGray8(image.data());
+        else
+            crtRender->ToRgb8(image.data());
+        if (!ImageUtil::savePngImage(screenshotFile->c_str(), width, height, numChannels,
+                                     image.data())) {
+            fprintf(stderr, "Failed to save screenshot: %s\n", screenshotFile->c_str());
+            return false;
         }
     }
 
-    return false;
+    return true;
 }
@@ -3,6 +3,7 @@
 #include "core/ConsoleOutput.h"
 #include "core/Gui.h"
 #include "emulator/EngineTypes.h"
+#include "soft_render/LineVertices.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -83,87 +84,8 @@ namespace {
         return {width, height};
     }
 
-    struct VertexData {
-        glm::vec2 v{};
-        float brightness{};
-    };
-
-    std::vector<VertexData> CreateQuadVertexArray(const std::vector<Line>& lines, float lineWidth,
-                                                  float scaleX, float scaleY) {
-        std::vector<VertexData> result;
-
-        const float MinPixelDist = 1.f;
-
-        // Make sure line width is at least one pixel wide to ensure it gets rendered
-        lineWidth = std::max(lineWidth, MinPixelDist);
-
-        float hlw = lineWidth / 2.0f;
-
-        for (auto& line : lines) {
-            // If end points are close, draw a dot instead of a line. We do this before applying any
-            // scale.
-            const bool isPoint = Magnitude(line.p0 - line.p1) <= 0.1f;
-
-            glm::vec2 p0{line.p0.x * scaleX, line.p0.y * scaleY};
-            glm::vec2 p1{line.p1.x * scaleX, line.p1.y * scaleY};
-
-            if (isPoint) {
-                auto a = VertexData{p0 + glm::vec2{hlw, hlw}, line.brightness};
-                auto b = VertexData{p0 + glm::vec2{hlw, -hlw}, line.brightness};
-                auto c = VertexData{p0 + glm::vec2{-hlw, -hlw}, line.brightness};
-                auto d = VertexData{p0 + glm::vec2{-hlw, hlw}, line.brightness};
-
-                result.insert(result.end(), {a, b, c, c, d, a});
-            } else {
-                auto v01 = p1 - p0;
-                glm::vec2 n = glm::normalize(v01);
-
-                // Make sure line gets at least one pixel coverage to ensure it gets rendered.
-                // Note that we extend p1, the end point, which means we may get some slight errors
-                // with attached lines. If we were to store "line strips" instead, we could correct
-                // the point in the strip, ensuring that strips don't get detached.
-                if (abs(v01.x) < MinPixelDist) {
-                    p1.x = p0.x + n.x * MinPixelDist;
-                }
-                if (abs(v01.y) < MinPixelDist) {
-                    p1.y = p0.y + n.y * MinPixelDist;
-                }
-
-                glm::vec2 bn(-n.y, n.x);
-
-                auto a = VertexData{p0 + bn * hlw, line.brightness};
-                auto b = VertexData{p0 - bn * hlw, line.brightness};
-                auto c = VertexData{p1 - bn * hlw, line.brightness};
-                auto d = VertexData{p1 + bn * hlw, line.brightness};
-
-                result.insert(result.end(), {a, b, c, c, d, a});
-            }
-        }
-        return result;
-    }
-
-    std::tuple<std::vector<VertexData>, std::vector<VertexData>>
-    CreateLineAndPointVertexArrays(const std::vector<Line>& lines, float scaleX, float scaleY) {
-        auto AlmostEqual = [](float a, float b, float epsilon = 0.01f) {
-            return abs(a - b) <= epsilon;
-        };
-
-        std::vector<VertexData> lineVA, pointVA;
-
-        for (auto& line : lines) {
-            glm::vec2 p0{line.p0.x * scaleX, line.p0.y * scaleY};
-            glm::vec2 p1{line.p1.x * scaleX, line.p1.y * scaleY};
-
-            if (AlmostEqual(p0.x, p1.x) && AlmostEqual(p0.y, p1.y)) {
-                pointVA.push_back({p0, line.brightness});
-            } else {
-                lineVA.push_back({p0, line.brightness});
-                lineVA.push_back({p1, line.brightness});
-            }
-        }
-
-        return {lineVA, pointVA};
-    }
+    using VertexData = LineVertices::Vertex;
+    using VertexArray = LineVertices::VertexArray;
 
     std::array<glm::vec3, 6> MakeClipSpaceQuad(float scaleX = 1.f, float scaleY = 1.f) {
         return {glm::vec3{-scaleX, -scaleY, 0.0f}, glm::vec3{scaleX, -scaleY, 0.0f},
@@ -276,8 +198,8 @@ namespace {
             m_shader.LoadShaders(ShaderSource::DrawVectors_vert, ShaderSource::DrawVectors_frag);
         }
 
-        void Draw(const std::vector<VertexData>& VA1, GLenum mode1,
-                  const std::vector<VertexData>& VA2, GLenum mode2, const Texture& outputTexture) {
+        void Draw(const VertexArray& VA1, GLenum mode1, const VertexArray& VA2, GLenum mode2,
+                  const Texture& outputTexture) {
             ScopedDebugGroup sdg("DrawVectorsPass");
 
             SetFrameBufferTexture(*m_textureFB, outputTexture.Id());
@@ -291,14 +213,14 @@ namespace {
             const auto mvp = m_projectionMatrix * m_modelViewMatrix;
             SetUniformMatrix4v(m_shader.Id(), "MVP", &mvp[0][0]);
 
-            auto DrawVertices = [](auto& VA, GLenum mode) {
-                if (VA.size() == 0)
+            auto DrawVertices = [](const VertexArray& VA, GLenum mode) {
+                if (VA.size == 0)
                     return;
 
                 auto vbo = MakeBufferResource();
 
                 glBindBuffer(GL_ARRAY_BUFFER, *vbo);
-                glBufferData(GL_ARRAY_BUFFER, VA.size() * sizeof(VertexData), VA.data(),
+                glBufferData(GL_ARRAY_BUFFER, VA.size * sizeof(VertexData), VA.vertices,
                              GL_DYNAMIC_DRAW);
 
                 glEnableVertexAttribArray(0);
@@ -310,7 +232,7 @@ namespace {
                                       GL_FLOAT,                      // type
                                       GL_FALSE,                      // normalized?
                                       sizeof(VertexData),            // stride
-                                      (void*)offsetof(VertexData, v) // array buffer offset
+                                      (void*)offsetof(VertexData, x) // array buffer offset
                 );
 
                 // Brightness values
@@ -322,7 +244,7 @@ namespace {
                                       (void*)offsetof(VertexData, brightness) // array buffer offset
                 );
 
-                glDrawArrays(mode, 0, checked_static_cast<GLsizei>(VA.size()));
+                glDrawArrays(mode, 0, checked_static_cast<GLsizei>(VA.size));
 
                 glDisableVertexAttribArray(1);
                 glDisableVertexAttribArray(0);
@@ -694,15 +616,16 @@ public:
         // Render normal lines and points, and darken
         IMGUI_CALL_IF(GLRenderImGui, Debug, ImGui::Checkbox("ThickBaseLines", &ThickBaseLines));
         if (!ThickBaseLines) {
-            std::tie(m_lineVA, m_pointVA) =
-                CreateLineAndPointVertexArrays(renderContext.lines, lineScaleX, lineScaleY);
-            m_drawVectorsPass.Draw(m_lineVA, GL_LINES, m_pointVA, GL_POINTS, currVectorsTexture0);
+            m_lineVertices.BuildLinesAndPoints(renderContext.lines, lineScaleX, lineScaleY);
+            m_drawVectorsPass.Draw(m_lineVertices.Lines(), GL_LINES, m_lineVertices.Points(),
+                                   GL_POINTS, currVectorsTexture0);
         } else {
             IMGUI_CALL_IF(GLRenderImGui, Debug,
                           ImGui::SliderFloat("LineWidthNormal", &LineWidthNormal, 0.1f, 3.0f));
-            m_quadVA = CreateQuadVertexArray(renderContext.lines, LineWidthNormal * lineWidthScale,
-                                             lineScaleX, lineScaleY);
-            m_drawVectorsPass.Draw(m_quadVA, GL_TRIANGLES, {}, {}, currVectorsTexture0);
+            m_lineVertices.BuildQuads(renderContext.lines, LineWidthNormal * lineWidthScale,
+                                      lineScaleX, lineScaleY);
+            m_drawVectorsPass.Draw(m_lineVertices.Quads(), GL_TRIANGLES, {}, {},
+                                   currVectorsTexture0);
         }
         m_darkenTexturePass.Draw(currVectorsTexture0, currVectorsTexture1,
                                  static_cast<float>(frameTime));
@@ -713,9 +636,10 @@ public:
             // Render thicker lines for blurring, darken, and apply glow
             IMGUI_CALL_IF(GLRenderImGui, Debug,
                           ImGui::SliderFloat("LineWidthGlow", &LineWidthGlow, 0.1f, 2.0f));
-            m_quadVA = CreateQuadVertexArray(renderContext.lines, LineWidthGlow * lineWidthScale,
-                                             lineScaleX, lineScaleY);
-            m_drawVectorsPass.Draw(m_quadVA, GL_TRIANGLES, {}, {}, currVectorsThickTexture0);
+            m_lineVertices.BuildQuads(renderContext.lines, LineWidthGlow * lineWidthScale,
+                                      lineScaleX, lineScaleY);
+            m_drawVectorsPass.Draw(m_lineVertices.Quads(), GL_TRIANGLES, {}, {},
+                                   currVectorsThickTexture0);
             m_darkenTexturePass.Draw(currVectorsThickTexture0, currVectorsThickTexture1,
                                      static_cast<float>(frameTime));
             m_glowPass.Draw(currVectorsThickTexture0, m_tempTexture, m_glowTexture);
@@ -738,9 +662,7 @@ private:
 
     Viewport m_screenViewport{};
 
-    std::vector<VertexData> m_quadVA;
-    std::vector<VertexData> m_lineVA;
-    std::vector<VertexData> m_pointVA;
+    LineVertices m_lineVertices;
 
     glm::mat4x4 m_projectionMatrix{};
     glm::mat4x4 m_modelViewMatrix{};
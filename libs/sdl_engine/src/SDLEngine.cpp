@@ -11,7 +11,10 @@
 #include "core/FrameTimer.h"
 #include "core/Gui.h"
 #include "core/Platform.h"
+#include "core/SpscRingBuffer.h"
 #include "core/StringUtil.h"
+#include "core/TripleBuffer.h"
+#include "core/TsQueue.h"
 #include "engine/EngineClient.h"
 #include "engine/EngineUtil.h"
 #include "engine/Options.h"
@@ -20,8 +23,11 @@
 #include <SDL.h>
 #include <SDL_net.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 #ifdef PLATFORM_WINDOWS
 #include <fcntl.h> // _O_BINARY
@@ -54,6 +60,16 @@ namespace {
         enum Type { Game, Menu, Size };
     }
 
+    // Rate at which the emulation thread runs frames, independently of the render rate
+    constexpr auto EmulationFramePeriod = std::chrono::microseconds(1'000'000 / 60);
+
+    // When pacing to the game's frames: the most time to emulate looking for the game's next frame
+    // boundary, how long to wait for the next frame before updating the UI without it, e.g. while
+    // in the debugger, and how often to check if a frame is ready.
+    constexpr double MaxPacedFrameTime = 0.1;
+    constexpr auto MaxPacedFrameWait = std::chrono::milliseconds(50);
+    constexpr auto PacedFramePollPeriod = std::chrono::microseconds(250);
+
     void HACK_Simulate3dImager(double frameTime, Input& input) {
         // @TODO: The 3D imager repeatedly sends button presses of joystick 2 button 4 at a given
         // frequency (apparently different depending on game). For now, I just enable it with a
@@ -146,14 +162,24 @@ public:
             SetStreamAutoFlush(true);
         }
 
+        // The client may call these from the emulation thread, while the window and GL context
+        // belong to this one
+        m_renderThreadId = std::this_thread::get_id();
         std::shared_ptr<IEngineService> engineService =
             std::make_shared<aggregate_adapter<IEngineService>>(
                 // SetFocusMainWindow
-                [this] { Platform::SetFocus(GetMainWindowHandle()); },
+                [this] {
+                    RunOnRenderThread([this] { Platform::SetFocus(GetMainWindowHandle()); });
+                },
                 // SetFocusConsole
-                [] { Platform::SetConsoleFocus(); },
+                [this] { RunOnRenderThread([] { Platform::SetConsoleFocus(); }); },
                 // ResetOverlay
-                [this](const char* file) { m_glRender.ResetOverlay(file); });
+                [this](const char* file) {
+                    RunOnRenderThread([this, file = file ? std::optional<std::string>(file)
+                                                         : std::nullopt] {
+                        m_glRender.ResetOverlay(file ? file->c_str() : nullptr);
+                    });
+                });
 
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) < 0) {
             std::cout << "SDL cannot init with error " << SDL_GetError() << std::endl;
@@ -181,6 +207,14 @@ public:
         m_options.Add<float>("volume", 0.5f);
         m_options.Add<bool>("vsync", false);
         m_options.Add<float>("brightnessCurve", 0.0f);
+        m_options.Add<int>("runAheadFrames", 0);
+        // Emulate on a separate thread from rendering. ImGui debug windows of the emulator are
+        // only available when this is disabled.
+        m_options.Add<bool>("emulationThread", true);
+        m_options.Add<bool>("framePacing", false);
+        // Lines beyond this in a frame are dropped, so that they can't pile up without bound while
+        // rendering is behind. 0 means no limit.
+        m_options.Add<int>("maxLinesPerFrame", 100'000);
         m_inputManager.AddOptions(m_options);
         m_options.SetFilePath(Paths::optionsFile);
         m_options.Load();
@@ -256,20 +290,39 @@ public:
             return false;
         }
 
-        RenderContext renderContext{};
-
         float CpuCyclesPerSec = 1'500'000;
         // float PsgCyclesPerSec = CpuCyclesPerSec / 16;
         // float PsgCyclesPerAudioSample = PsgCyclesPerSec / m_audioDriver.GetSampleRate();
         float CpuCyclesPerAudioSample = CpuCyclesPerSec / m_audioDriver.GetSampleRate();
         AudioContext audioContext{CpuCyclesPerAudioSample};
 
+        // Up to a second of samples in flight between the emulation and render threads
+        m_audioSamples.Init(m_audioDriver.GetSampleRate());
+        m_framePacing = m_options.Get<bool>("framePacing");
+        m_maxLinesPerFrame =
+            static_cast<size_t>(std::max(m_options.Get<int>("maxLinesPerFrame"), 0));
+
+        // From here on, this thread only handles input, UI, rendering and audio output, and hands
+        // off to the emulation thread through the members below. Without an emulation thread, the
+        // same handoff is done on this thread, with one emulated frame per rendered frame.
+        if (m_options.Get<bool>("emulationThread")) {
+            m_emulationThread =
+                std::thread([this, &audioContext] { EmulationThread(audioContext); });
+        }
+
         bool quit = false;
         while (!quit) {
+            RunRenderThreadTasks();
+
             PollEvents(quit);
             UpdatePauseState(m_paused[PauseSource::Game]);
-            auto input = UpdateInput();
-            const auto frameTime = UpdateFrameTime();
+            UpdateTurboMode();
+
+            m_inputs.WriteBuffer() = UpdateInput();
+            m_inputs.Publish();
+
+            m_frameTimer.FrameUpdate();
+            const double frameTime = IsPaused() ? 0.0 : m_frameTimer.GetFrameTime();
 
             auto emuEvents = EmuEvents{};
             if (m_keyboard.GetKeyState(SDL_SCANCODE_LCTRL).down &&
@@ -294,41 +347,81 @@ public:
                 emuEvents.push_back({EmuEvent::OpenRomFile{}});
             }
 
+            // Rewind one frame per frame while held, so it plays back in reverse
+            if (m_keyboard.GetKeyState(SDL_SCANCODE_BACKSPACE).down) {
+                emuEvents.push_back({EmuEvent::Rewind{1}});
+            }
+
             ImGui_ImplSdlGL3_NewFrame(m_window);
 
             UpdateMenu(quit, emuEvents);
 
-            HACK_Simulate3dImager(frameTime, input);
+            // Events are handled by the next emulated frame
+            for (auto& emuEvent : emuEvents) {
+                m_emuEvents.push(std::move(emuEvent));
+            }
+            m_emuPaused = IsPaused();
+            m_emuTurbo = IsTurboMode();
+            m_emuFramePacing = m_framePacing;
 
-            if (!m_client->FrameUpdate(frameTime, {std::ref(emuEvents), std::ref(m_options)}, input,
-                                       renderContext, audioContext)) {
+            if (!m_emulationThread.joinable()) {
+                EmulateFrame(audioContext);
+            }
+            if (m_clientQuit) {
                 quit = true;
             }
 
             // Audio update
-            m_audioDriver.AddSamples(audioContext.samples.data(), audioContext.samples.size());
-            audioContext.samples.clear();
+            std::array<float, 1024> samples;
+            while (size_t numSamples = m_audioSamples.Pop(samples.data(), samples.size())) {
+                m_audioDriver.AddSamples(samples.data(), numSamples);
+            }
             m_audioDriver.Update(frameTime);
 
-            // Render update
-            const size_t MaxLinesInTurboMode = 1'000;
-            if (IsTurboMode() && renderContext.lines.size() > MaxLinesInTurboMode) {
-                renderContext.lines.resize(MaxLinesInTurboMode);
+            // When pacing to the game's frames, each one is presented when it's due, i.e. after
+            // the time emulated for the previous one
+            const bool framePacing = m_framePacing && !IsPaused() && !IsTurboMode();
+            if (framePacing) {
+                const auto waitEnd = std::chrono::steady_clock::now() + MaxPacedFrameWait;
+                while (m_renderContexts.Consumed() && !m_clientQuit &&
+                       std::chrono::steady_clock::now() < waitEnd) {
+                    std::this_thread::sleep_for(PacedFramePollPeriod);
+                }
             }
 
-            m_glRender.RenderScene(frameTime, renderContext);
+            // Render update. Only the latest emulated frame is drawn. If there isn't a new one,
+            // no lines are drawn, so that the last ones fade out, unless paused, in which case the
+            // last frame remains displayed.
+            const bool newFrame = m_renderContexts.Consume();
+            if (newFrame && framePacing) {
+                // Clients that don't report it emulate the whole frame time
+                const double emulatedTime = m_renderContexts.ReadBuffer().emulatedTime;
+                m_framePacer.WaitForNextFrame(emulatedTime > 0 ? emulatedTime : MaxPacedFrameTime);
+            }
+            m_glRender.RenderScene(frameTime, newFrame || frameTime == 0
+                                                  ? m_renderContexts.ReadBuffer()
+                                                  : m_noLinesRenderContext);
+            UpdateDebugUI();
             ImGui_Render();
             SDL_GL_SwapWindow(m_window);
 
-            // Don't clear lines when paused
-            if (frameTime > 0) {
-                renderContext.lines.clear();
+            const auto presentTime = std::chrono::steady_clock::now();
+            if (m_lastPresentTime != decltype(m_lastPresentTime){}) {
+                m_presentTimes.AddFrameTime(
+                    std::chrono::duration<double>(presentTime - m_lastPresentTime).count());
             }
+            m_lastPresentTime = presentTime;
 
             m_keyboard.PostFrameUpdateKeyStates();
             m_controllerDriver.PostFrameUpdateKeyStates();
         }
 
+        // If the debugger is waiting on console input, this waits until it's given
+        m_emuQuit = true;
+        if (m_emulationThread.joinable()) {
+            m_emulationThread.join();
+        }
+
         m_client->Shutdown();
 
         m_audioDriver.Shutdown();
@@ -440,20 +533,107 @@ private:
         }
     }
 
-    double UpdateFrameTime() {
-        m_frameTimer.FrameUpdate();
-        double frameTime = m_frameTimer.GetFrameTime();
+    void EmulationThread(AudioContext& audioContext) {
+        auto nextFrameTime = std::chrono::steady_clock::now();
+        while (!m_emuQuit && !m_clientQuit) {
+            // When pacing to the game's frames, the render thread presents each frame when it's
+            // due, and the next one is emulated as soon as it's taken
+            const bool framePacing = m_emuFramePacing;
+            if (framePacing && !m_renderContexts.Consumed()) {
+                std::this_thread::sleep_for(PacedFramePollPeriod);
+                continue;
+            }
+
+            if (EmulateFrame(audioContext) && framePacing) {
+                nextFrameTime = std::chrono::steady_clock::now();
+                continue;
+            }
+
+            // Don't try to catch up on frames we fell behind on, e.g. while in the debugger
+            nextFrameTime += EmulationFramePeriod;
+            if (const auto now = std::chrono::steady_clock::now(); nextFrameTime < now) {
+                nextFrameTime = now;
+            } else {
+                std::this_thread::sleep_until(nextFrameTime);
+            }
+        }
+    }
+
+    // Runs on the emulation thread, if any, or the render thread otherwise. Returns true if a frame
+    // was published to the render thread.
+    bool EmulateFrame(AudioContext& audioContext) {
+        m_emuFrameTimer.FrameUpdate();
+        double frameTime = m_emuFrameTimer.GetFrameTime();
 
         // Reset to 0 if paused
-        if (IsPaused())
+        if (m_emuPaused)
             frameTime = 0.0;
 
         // Scale up if turbo
-        UpdateTurboMode();
-        if (IsTurboMode())
+        const bool turbo = m_emuTurbo;
+        if (turbo)
             frameTime *= 10;
 
-        return frameTime;
+        // Use the latest input, or the last one if there isn't a new one
+        m_inputs.Consume();
+        Input input = m_inputs.ReadBuffer();
+
+        auto emuEvents = EmuEvents{};
+        while (auto emuEvent = m_emuEvents.pop()) {
+            emuEvents.push_back(std::move(*emuEvent));
+        }
+        if (turbo) {
+            emuEvents.push_back({EmuEvent::FastForward{}});
+        } else if (m_emuFramePacing && frameTime > 0) {
+            // Emulate the game's next frame, however long it takes
+            frameTime = MaxPacedFrameTime;
+            emuEvents.push_back({EmuEvent::WholeFrame{}});
+        }
+
+        HACK_Simulate3dImager(frameTime, input);
+
+        // Lines accumulate until the render thread has taken the last published frame, so that
+        // none are lost when emulating faster than rendering
+        RenderContext& renderContext = m_renderContexts.WriteBuffer();
+        renderContext.lines.SetMaxLines(m_maxLinesPerFrame);
+        // Read directly by GLRender's SIMD vertex building (see LineVertices)
+        renderContext.lines.SetLayout(LineBuffer::Layout::Arrays);
+        if (m_renderContextPublished) {
+            renderContext.lines.Clear();
+            renderContext.emulatedTime = 0;
+            m_renderContextPublished = false;
+        }
+
+        if (!m_client->FrameUpdate(frameTime, {std::ref(emuEvents), std::ref(m_options)}, input,
+                                   renderContext, audioContext)) {
+            m_clientQuit = true;
+        }
+
+        m_audioSamples.Push(audioContext.samples.data(), audioContext.samples.size());
+        audioContext.samples.clear();
+
+        // Don't publish when paused, so that the last frame remains displayed
+        if (frameTime > 0 && m_renderContexts.Consumed()) {
+            m_renderContexts.Publish();
+            m_renderContextPublished = true;
+        }
+        return m_renderContextPublished;
+    }
+
+    // Runs the task right away if called from the render thread, otherwise queues it to be run by
+    // the render thread at the start of its next frame
+    void RunOnRenderThread(std::function<void()> task) {
+        if (std::this_thread::get_id() == m_renderThreadId) {
+            task();
+        } else {
+            m_renderThreadTasks.push(std::move(task));
+        }
+    }
+
+    void RunRenderThreadTasks() {
+        while (auto task = m_renderThreadTasks.pop()) {
+            (*task)();
+        }
     }
 
     void UpdateMenu(bool& quit, EmuEvents& emuEvents) {
@@ -492,6 +672,9 @@ private:
                     emuEvents.push_back({EmuEvent::Reset{}});
 
                 ImGui::MenuItem("Pause", "P", &m_paused[PauseSource::Game]);
+
+                if (ImGui::MenuItem("Rewind 1 second", "Backspace (hold)"))
+                    emuEvents.push_back({EmuEvent::Rewind{60}});
                 ImGui::EndMenu();
             }
 
@@ -510,6 +693,16 @@ private:
                     }
                 }
 
+                // Frames emulated ahead of the displayed one, to reduce input latency
+                static int runAheadFrames = m_options.Get<int>("runAheadFrames");
+                ImGui::SliderInt("Run-ahead frames", &runAheadFrames, 0, 4);
+                if (runAheadFrames != m_options.Get<int>("runAheadFrames")) {
+                    // Just update the value in the options file. This value must be polled by the
+                    // engine client.
+                    m_options.Set("runAheadFrames", runAheadFrames);
+                    m_options.Save();
+                }
+
                 ImGui::Separator();
                 ImGui::Text("Display");
                 static bool vsync = m_options.Get<bool>("vsync");
@@ -520,6 +713,15 @@ private:
                     m_options.Save();
                 }
 
+                // Present frames at the game's own rate (usually 50 Hz), which is smoother with
+                // VSync off
+                ImGui::Checkbox("Frame pacing", &m_framePacing);
+                if (m_framePacing != m_options.Get<bool>("framePacing")) {
+                    m_framePacer.Reset();
+                    m_options.Set("framePacing", m_framePacing);
+                    m_options.Save();
+                }
+
                 static float brightnessCurve = m_options.Get<float>("brightnessCurve");
                 ImGui::SliderFloat("Brightness curve", &brightnessCurve, 0.f, 1.f);
                 if (brightnessCurve != m_options.Get<float>("brightnessCurve")) {
@@ -596,6 +798,14 @@ private:
 #endif
     }
 
+    void UpdateDebugUI() {
+        IMGUI_CALL(Debug, ImGui::Text("Frame times (ms): 50%% %.2f, 90%% %.2f, 99%% %.2f, max %.2f",
+                                      m_presentTimes.Percentile(50) * 1000,
+                                      m_presentTimes.Percentile(90) * 1000,
+                                      m_presentTimes.Percentile(99) * 1000,
+                                      m_presentTimes.Percentile(100) * 1000));
+    }
+
     void UpdateMenu_AboutPopup(bool openPopup) {
         if (openPopup) {
             ImGui::OpenPopup("About Vectrexy");
@@ -807,6 +1017,30 @@ private:
     FrameTimer m_frameTimer;
     bool m_paused[PauseSource::Size]{};
     bool m_turbo = false;
+    RenderContext m_noLinesRenderContext;
+    bool m_framePacing = false;
+    FramePacer m_framePacer;
+    FrameTimeStats m_presentTimes;
+    std::chrono::steady_clock::time_point m_lastPresentTime{};
+
+    // Handoff between the render thread and the emulation thread
+    std::thread::id m_renderThreadId;
+    std::thread m_emulationThread;
+    TripleBuffer<Input> m_inputs;                       // Render -> emulation
+    TsQueue<EmuEvent> m_emuEvents;                      // Render -> emulation
+    std::atomic<bool> m_emuPaused = false;              // Render -> emulation
+    std::atomic<bool> m_emuTurbo = false;               // Render -> emulation
+    std::atomic<bool> m_emuFramePacing = false;         // Render -> emulation
+    std::atomic<bool> m_emuQuit = false;                // Render -> emulation
+    TripleBuffer<RenderContext> m_renderContexts;       // Emulation -> render
+    SpscRingBuffer<float> m_audioSamples;               // Emulation -> render
+    TsQueue<std::function<void()>> m_renderThreadTasks; // Emulation -> render
+    std::atomic<bool> m_clientQuit = false;             // Emulation -> render
+
+    // Emulation thread only
+    FrameTimer m_emuFrameTimer;
+    bool m_renderContextPublished = false;
+    size_t m_maxLinesPerFrame = 0; // Set before the thread starts
 };
 
 SDLEngine::SDLEngine() = default;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/Base.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs work split into bands, such as groups of framebuffer rows, on a pool of worker threads and
+// the calling thread. Bands are handed out one at a time, so that threads that get cheap bands pick
+// up more of them.
+class BandPool {
+public:
+    BandPool() = default;
+    ~BandPool();
+    BandPool(const BandPool&) = delete;
+    BandPool& operator=(const BandPool&) = delete;
+
+    // If numThreads is 0, one thread per hardware thread is used
+    void Init(int numThreads = 0);
+
+    int NumThreads() const { return static_cast<int>(m_workers.size()) + 1; }
+
+    // Calls func for each band in [0, numBands), and returns once all calls are done. Calls for
+    // different bands may run concurrently.
+    void Run(int numBands, const std::function<void(int band)>& func);
+
+private:
+    void RunRemainingBands(); // Until no bands are left
+    void WorkerThread();
+    void StopWorkers();
+
+    // Of the current Run call
+    const std::function<void(int band)>* m_func{};
+    int m_numBands{};
+    std::atomic<int> m_nextBand{};
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition; // Signals workers a new generation of bands
+    std::condition_variable m_doneCondition; // Signals Run when workers are done
+    uint64_t m_generation{};
+    size_t m_busyWorkers{};
+    bool m_quitWorkers{};
+};
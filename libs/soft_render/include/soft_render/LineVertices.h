@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core/Base.h"
+#include "core/LineBuffer.h"
+#include "soft_render/SoftRender.h"
+#include <vector>
+
+// Builds the vertices GLRender draws lines with. This is CPU work, so it lives here rather than in
+// the GL renderer, where it can be tested and benchmarked without a GL context.
+//
+// Lines are processed in batches of 4 or 8 with SSE2 or AVX2 when available, reading LineBuffer's
+// Layout::Arrays storage directly; lines in Layout::Lines are transposed to it first. Vertices are
+// written to buffers kept across calls, so that once they've grown to fit the busiest frame,
+// building doesn't allocate.
+class LineVertices {
+public:
+    // Same layout as GLRender's vertex attributes
+    struct Vertex {
+        float x{}, y{};
+        float brightness{};
+    };
+
+    // Vertices in one of the buffers, valid until the next Build call
+    struct VertexArray {
+        const Vertex* vertices{};
+        size_t size{};
+    };
+
+    LineVertices();
+
+    // Defaults to SoftRender::BestSimd(). All instruction sets produce the same vertices.
+    void SetSimd(SoftRender::Simd simd);
+    SoftRender::Simd GetSimd() const { return m_simd; }
+
+    // Expands each line to a quad for GL_TRIANGLES, 6 vertices per line. Lines are scaled from
+    // vectrex space by scaleX and scaleY, and lineWidth is in the scaled space. Lines and quads
+    // are made at least one unit wide and long, so that they cover a pixel. Lines shorter than
+    // 0.1 in vectrex space are drawn as square dots.
+    void BuildQuads(const LineBuffer& lines, float lineWidth, float scaleX, float scaleY);
+    VertexArray Quads() const { return {m_quads.data(), m_numQuadVertices}; }
+
+    // Splits lines into GL_LINES, 2 vertices per line, and GL_POINTS for lines whose scaled end
+    // points are within 0.01 of each other
+    void BuildLinesAndPoints(const LineBuffer& lines, float scaleX, float scaleY);
+    VertexArray Lines() const { return {m_lines.data(), m_numLineVertices}; }
+    VertexArray Points() const { return {m_points.data(), m_numPointVertices}; }
+
+private:
+    LineBuffer::Arrays ToArrays(const LineBuffer& lines);
+
+    using BuildQuadsFunc = void (*)(const LineBuffer::Arrays& lines, size_t numLines,
+                                    float halfWidth, float scaleX, float scaleY, Vertex* out);
+    // Returns the number of points
+    using BuildLinesAndPointsFunc = size_t (*)(const LineBuffer::Arrays& lines, size_t numLines,
+                                               float scaleX, float scaleY, Vertex* lineOut,
+                                               Vertex* pointOut);
+
+    SoftRender::Simd m_simd{SoftRender::Simd::Scalar};
+    BuildQuadsFunc m_buildQuads{};
+    BuildLinesAndPointsFunc m_buildLinesAndPoints{};
+
+    // Layout::Lines input, transposed to Layout::Arrays. Only grown, like the vertex buffers.
+    std::vector<float> m_x0, m_y0, m_x1, m_y1, m_brightness;
+
+    // Only grown, so that the vertices in use are the first m_num*Vertices
+    std::vector<Vertex> m_quads;
+    std::vector<Vertex> m_lines;
+    std::vector<Vertex> m_points;
+    size_t m_numQuadVertices{};
+    size_t m_numLineVertices{};
+    size_t m_numPointVertices{};
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/Base.h"
+#include "core/LineBuffer.h"
+#include "soft_render/BandPool.h"
+#include "soft_render/SoftRender.h"
+#include <array>
+#include <vector>
+
+// CPU equivalent of GLRender's passes, so that headless captures look like what players see:
+//
+// - Lines are drawn with SoftRender on top of the previous frame's, which decay exponentially with
+//   frame time like a phosphor (DarkenTexturePass).
+// - Wider lines are drawn and decayed the same way in a separate buffer, and blurred with the same
+//   9-tap separable Gaussian (GlowPass).
+// - The two are combined with max into the CRT area, centered in the screen
+//   (CombineVectorsAndGlowPass).
+// - The overlay, if any, is composited on top (RenderToScreenPass).
+//
+// Unlike GLRender, lines are anti-aliased, and drawn over the decayed image with max rather than
+// overwriting it.
+//
+// Each stage is a SIMD kernel, run in parallel over bands of rows on a shared BandPool, and timed
+// separately.
+class SoftCrtRender {
+public:
+    enum class Stage { Darken, DrawVectors, DrawGlowVectors, Glow, Combine, Composite, Count };
+    static const char* StageName(Stage stage);
+
+    // Same as GLRender's
+    static constexpr float LineWidthGlow = 1.f;
+    static constexpr float GlowRadius = 1.2f;
+    static constexpr float DarkenSpeedScale = 3.f;
+    static constexpr float OverlayAlpha = 1.f;
+    static constexpr float CrtScaleX = 1.f;
+    static constexpr float CrtScaleY = 0.8f;
+
+    // The screen is the area the overlay covers, and the CRT a centered part of it. If numThreads
+    // is 0, one thread per hardware thread is used.
+    void Init(int screenWidth, int screenHeight, int numThreads = 0);
+
+    void SetSimd(SoftRender::Simd simd);
+    SoftRender::Simd GetSimd() const { return m_vectors.GetSimd(); }
+
+    // Resamples the RGBA overlay image (top row first) to the screen. Null removes the overlay.
+    void SetOverlay(const uint8_t* rgba, int width, int height);
+
+    // Same, from a png file, as GLRender::ResetOverlay. Returns false if it can't be loaded.
+    bool LoadOverlay(const char* file);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int NumThreads() const { return m_pool.NumThreads(); }
+
+    // Draws a frame. Previous frames only decay if frameTime is positive.
+    void Render(double frameTime, const LineBuffer& lines);
+
+    // Writes Width() * Height() RGB values of the last frame
+    void ToRgb8(uint8_t* out) const;
+
+    // Total time spent in each stage since Init or ResetStageTimes
+    double StageSeconds(Stage stage) const { return m_stageSeconds[static_cast<size_t>(stage)]; }
+    void ResetStageTimes() { m_stageSeconds = {}; }
+
+private:
+    using Plane = std::vector<float>;
+
+    template <typename Func>
+    void RunStage(Stage stage, Func func);
+
+    void Darken(float frameTime);
+    void Glow();
+    void Combine();
+    void Composite();
+
+    int m_width{};
+    int m_height{};
+    int m_crtX{}, m_crtY{}; // Of the CRT's top left corner in the screen
+    int m_numScreenBands{};
+    int m_numCrtBands{};
+    BandPool m_pool;
+
+    SoftRender m_vectors;     // Persistent, decaying
+    SoftRender m_glowVectors; // Same, with wider lines
+    Plane m_tempGlow;         // Glowed horizontally
+    Plane m_glow;
+    Plane m_screen;           // CRT image in the screen
+
+    // Whether each row of m_glowVectors has any lit pixel
+    std::vector<uint8_t> m_glowRowLit;
+
+    bool m_hasOverlay{};
+    std::array<Plane, 3> m_overlayColor; // RGB, resampled to the screen
+    Plane m_overlayRatio;                // Overlay opacity with OverlayAlpha applied
+    std::array<Plane, 3> m_output;       // Composited RGB, if there's an overlay
+
+    std::array<double, static_cast<size_t>(Stage::Count)> m_stageSeconds{};
+};
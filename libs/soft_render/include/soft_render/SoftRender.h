@@ -0,0 +1,91 @@
+#pragma once
+
+#include "core/Base.h"
+#include "core/LineBuffer.h"
+#include "soft_render/BandPool.h"
+#include <memory>
+#include <vector>
+
+// CPU renderer for headless use: draws anti-aliased lines and dots, such as those of
+// RenderContext::lines, into a grayscale float framebuffer of any size. Like GLRender, the 256x256
+// vectrex screen, centered on the origin with y up, is stretched to the framebuffer, and line width
+// is scaled with its width.
+//
+// Each line is drawn as a capsule: pixel coverage falls off linearly over one pixel at distance
+// lineWidth / 2 from the line, and is multiplied by the line's brightness. Coverage is combined
+// with max rather than added, so that the result doesn't depend on the order lines are drawn in,
+// nor on how many times overlapping segments cover a pixel.
+//
+// The framebuffer is split into bands of rows drawn in parallel on a BandPool. Pixels of a row are
+// evaluated in groups with SSE2 or AVX2 when available.
+class SoftRender {
+public:
+    enum class Simd { Scalar, Sse2, Avx2 }; // In order of preference
+
+    // Same as GLRender's, in vectrex units
+    static constexpr float LineWidthNormal = 0.4f;
+
+    // Best instruction set supported by this CPU
+    static Simd BestSimd();
+    static const char* SimdName(Simd simd);
+
+    SoftRender();
+
+    // Allocates a cleared framebuffer. If numThreads is 0, one thread per hardware thread is used.
+    void Init(int width, int height, int numThreads = 0);
+
+    // Same, but draws on a pool shared with other work, which must outlive this
+    void Init(int width, int height, BandPool& pool);
+
+    // Defaults to BestSimd(). Instruction sets the CPU doesn't support fall back to the best one it
+    // does.
+    void SetSimd(Simd simd);
+    Simd GetSimd() const { return m_simd; }
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int NumThreads() const { return m_pool->NumThreads(); }
+
+    void Clear();
+
+    // Draws on top of what's already in the framebuffer
+    void DrawLines(const LineBuffer& lines, float lineWidth = LineWidthNormal);
+
+    // Row-major, top row first, with 1 being full brightness
+    const float* Pixels() const { return m_pixels.data(); }
+    float* Pixels() { return m_pixels.data(); }
+
+    // Writes Width() * Height() 8-bit values, clamping brightness to 1
+    void ToGray8(uint8_t* out) const;
+
+private:
+    // Line in framebuffer space
+    struct Segment {
+        float x0{}, y0{};
+        float dx{}, dy{};     // From start to end
+        float invLength2{};   // 0 for dots
+        float radius{};       // Distance from the line at which coverage reaches 0
+        float brightness{};
+        float minX{}, maxX{}; // Bounding box, including radius
+        int minRow{}, maxRow{};
+        float dxPerRow{}; // Of the line, so that rows only visit pixels near where it crosses them
+        float halfSpan{}; // Of the pixels near the crossing, infinite for horizontal lines and dots
+    };
+
+    using DrawRowFunc = void (*)(const Segment& segment, float* row, float rowCenterY, int x0,
+                                 int x1, int width);
+
+    void DrawBand(int band);
+
+    int m_width{};
+    int m_height{};
+    std::vector<float> m_pixels;
+    Simd m_simd{Simd::Scalar};
+    DrawRowFunc m_drawRow{};
+
+    std::vector<Segment> m_segments; // Of the current DrawLines call
+    int m_numBands{};
+
+    std::unique_ptr<BandPool> m_ownPool; // If not given one
+    BandPool* m_pool{};
+};
@@ -0,0 +1,76 @@
+#include "soft_render/BandPool.h"
+#include <algorithm>
+
+BandPool::~BandPool() {
+    StopWorkers();
+}
+
+void BandPool::Init(int numThreads) {
+    if (numThreads <= 0)
+        numThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    StopWorkers();
+    for (int i = 1; i < numThreads; ++i) {
+        m_workers.emplace_back([this] { WorkerThread(); });
+    }
+}
+
+void BandPool::Run(int numBands, const std::function<void(int band)>& func) {
+    m_func = &func;
+    m_numBands = numBands;
+    m_nextBand = 0;
+
+    if (m_workers.empty() || numBands <= 1) {
+        RunRemainingBands();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        m_busyWorkers = m_workers.size();
+    }
+    m_workCondition.notify_all();
+
+    RunRemainingBands();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_busyWorkers == 0; });
+}
+
+void BandPool::RunRemainingBands() {
+    for (int band = m_nextBand++; band < m_numBands; band = m_nextBand++)
+        (*m_func)(band);
+}
+
+void BandPool::WorkerThread() {
+    uint64_t generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workCondition.wait(lock,
+                                 [&] { return m_quitWorkers || m_generation != generation; });
+            if (m_quitWorkers)
+                return;
+            generation = m_generation;
+        }
+
+        RunRemainingBands();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+            m_doneCondition.notify_one();
+    }
+}
+
+void BandPool::StopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quitWorkers = true;
+    }
+    m_workCondition.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+    m_quitWorkers = false;
+}
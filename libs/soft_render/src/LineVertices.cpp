@@ -0,0 +1,522 @@
+#include "soft_render/LineVertices.h"
+#include "Simd.h"
+#include "core/ErrorHandler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    using Vertex = LineVertices::Vertex;
+    using Arrays = LineBuffer::Arrays;
+
+    constexpr float MinPixelDist = 1.f;  // Minimum quad width, and line length along each axis
+    constexpr float MaxDotLength = 0.1f; // In vectrex space
+    constexpr float PointEpsilon = 0.01f;
+
+    // Quads are made of corners a, b, c and d, as the triangles abc and cda. Relative to the line's
+    // start p0 and end p1, a = p0 + offsetA, b = p0 + offsetB, c = p1 - offsetA and
+    // d = p1 - offsetB. For dots, p1 is p0 and the offsets are diagonals of the square.
+    struct Quad {
+        float ax, ay, bx, by, cx, cy, dx, dy;
+        float brightness;
+    };
+
+    void WriteQuad(const Quad& q, Vertex* out) {
+        const Vertex a{q.ax, q.ay, q.brightness};
+        const Vertex c{q.cx, q.cy, q.brightness};
+        out[0] = a;
+        out[1] = {q.bx, q.by, q.brightness};
+        out[2] = c;
+        out[3] = c;
+        out[4] = {q.dx, q.dy, q.brightness};
+        out[5] = a;
+    }
+
+    // SIMD versions compute quads the same way, with the same operations in the same order, so
+    // that they produce the same vertices
+    void BuildQuad(const Arrays& lines, size_t i, float halfWidth, float scaleX, float scaleY,
+                   Vertex* out) {
+        // If end points are close, draw a dot instead of a line. We do this before applying any
+        // scale.
+        const float ux = lines.x1[i] - lines.x0[i];
+        const float uy = lines.y1[i] - lines.y0[i];
+        const bool isDot = std::sqrt(ux * ux + uy * uy) <= MaxDotLength;
+
+        const float p0x = lines.x0[i] * scaleX;
+        const float p0y = lines.y0[i] * scaleY;
+        float p1x = lines.x1[i] * scaleX;
+        float p1y = lines.y1[i] * scaleY;
+
+        float offsetAX{}, offsetAY{}, offsetBX{}, offsetBY{};
+        if (isDot) {
+            p1x = p0x;
+            p1y = p0y;
+            offsetAX = halfWidth;
+            offsetAY = halfWidth;
+            offsetBX = halfWidth;
+            offsetBY = -halfWidth;
+        } else {
+            const float vx = p1x - p0x;
+            const float vy = p1y - p0y;
+            const float invLength = 1.f / std::sqrt(vx * vx + vy * vy);
+            const float nx = vx * invLength;
+            const float ny = vy * invLength;
+
+            // Make sure line gets at least one pixel coverage to ensure it gets rendered. Note that
+            // we extend p1, the end point, which means we may get some slight errors with attached
+            // lines. If we were to store "line strips" instead, we could correct the point in the
+            // strip, ensuring that strips don't get detached.
+            if (std::abs(vx) < MinPixelDist)
+                p1x = p0x + nx * MinPixelDist;
+            if (std::abs(vy) < MinPixelDist)
+                p1y = p0y + ny * MinPixelDist;
+
+            // Along the normal
+            offsetAX = -ny * halfWidth;
+            offsetAY = nx * halfWidth;
+            offsetBX = -offsetAX;
+            offsetBY = -offsetAY;
+        }
+
+        WriteQuad({p0x + offsetAX, p0y + offsetAY, p0x + offsetBX, p0y + offsetBY, p1x - offsetAX,
+                   p1y - offsetAY, p1x - offsetBX, p1y - offsetBY, lines.brightness[i]},
+                  out);
+    }
+
+    // Returns whether the line is a point
+    bool BuildLineOrPoint(const Arrays& lines, size_t i, float scaleX, float scaleY,
+                          Vertex* lineOut, Vertex* pointOut) {
+        const float p0x = lines.x0[i] * scaleX;
+        const float p0y = lines.y0[i] * scaleY;
+        const float p1x = lines.x1[i] * scaleX;
+        const float p1y = lines.y1[i] * scaleY;
+        const float brightness = lines.brightness[i];
+
+        if (std::abs(p0x - p1x) <= PointEpsilon && std::abs(p0y - p1y) <= PointEpsilon) {
+            *pointOut = {p0x, p0y, brightness};
+            return true;
+        }
+        lineOut[0] = {p0x, p0y, brightness};
+        lineOut[1] = {p1x, p1y, brightness};
+        return false;
+    }
+
+    void BuildQuadsScalar(const Arrays& lines, size_t numLines, float halfWidth, float scaleX,
+                          float scaleY, Vertex* out) {
+        for (size_t i = 0; i < numLines; ++i)
+            BuildQuad(lines, i, halfWidth, scaleX, scaleY, out + i * 6);
+    }
+
+    size_t BuildLinesAndPointsScalar(const Arrays& lines, size_t numLines, float scaleX,
+                                     float scaleY, Vertex* lineOut, Vertex* pointOut) {
+        size_t numPoints = 0;
+        for (size_t i = 0; i < numLines; ++i) {
+            if (BuildLineOrPoint(lines, i, scaleX, scaleY, lineOut, pointOut + numPoints))
+                ++numPoints;
+            else
+                lineOut += 2;
+        }
+        return numPoints;
+    }
+
+    // Results of a batch of lines, one array per value, so that SIMD code can store them with
+    // aligned stores before they're split into lines and points
+    template <int Lanes>
+    struct LineBatch {
+        alignas(32) float p0x[Lanes], p0y[Lanes], p1x[Lanes], p1y[Lanes];
+        alignas(32) float brightness[Lanes];
+
+        // Bit l of pointMask is set if line l is a point. Returns the number of points.
+        size_t Write(int pointMask, Vertex*& lineOut, Vertex* pointOut) const {
+            size_t numPoints = 0;
+            for (int l = 0; l < Lanes; ++l) {
+                if (pointMask & (1 << l)) {
+                    pointOut[numPoints++] = {p0x[l], p0y[l], brightness[l]};
+                } else {
+                    lineOut[0] = {p0x[l], p0y[l], brightness[l]};
+                    lineOut[1] = {p1x[l], p1y[l], brightness[l]};
+                    lineOut += 2;
+                }
+            }
+            return numPoints;
+        }
+    };
+
+#ifdef SOFT_RENDER_X86
+    // Quad vertices are stored 16 bytes at a time, as (x, y, brightness, brightness), in order, so
+    // that the last 4 bytes of each store are overwritten by the next one. The last store of a
+    // batch spills into the first vertex of the next line, or the padding vertex at the end of the
+    // buffer.
+    static_assert(sizeof(Vertex) == 3 * sizeof(float));
+
+    SIMD_TARGET("sse2")
+    void StoreQuad(__m128 a, __m128 b, __m128 c, __m128 d, Vertex* out) {
+        float* p = &out->x;
+        _mm_storeu_ps(p, a);
+        _mm_storeu_ps(p + 3, b);
+        _mm_storeu_ps(p + 6, c);
+        _mm_storeu_ps(p + 9, c);
+        _mm_storeu_ps(p + 12, d);
+        _mm_storeu_ps(p + 15, a);
+    }
+
+    // Interleaves 4 lanes of x and y with brightness, given as (b0, b0, b1, b1) and
+    // (b2, b2, b3, b3), into one vertex per lane
+    SIMD_TARGET("sse2")
+    void InterleaveSse2(__m128 x, __m128 y, __m128 brightnessLo, __m128 brightnessHi,
+                        __m128 (&vertices)[4]) {
+        const __m128 xyLo = _mm_unpacklo_ps(x, y);
+        const __m128 xyHi = _mm_unpackhi_ps(x, y);
+        vertices[0] = _mm_movelh_ps(xyLo, brightnessLo);
+        vertices[1] = _mm_movehl_ps(brightnessLo, xyLo);
+        vertices[2] = _mm_movelh_ps(xyHi, brightnessHi);
+        vertices[3] = _mm_movehl_ps(brightnessHi, xyHi);
+    }
+
+    // Same for 8 lanes, with brightness given as (b0, b0, b1, b1 | b4, b4, b5, b5) and
+    // (b2, b2, b3, b3 | b6, b6, b7, b7)
+    SIMD_TARGET("avx2")
+    void InterleaveAvx2(__m256 x, __m256 y, __m256 brightnessLo, __m256 brightnessHi,
+                        __m128 (&vertices)[8]) {
+        const __m256 xyLo = _mm256_unpacklo_ps(x, y);
+        const __m256 xyHi = _mm256_unpackhi_ps(x, y);
+        const __m256 v0 = _mm256_shuffle_ps(xyLo, brightnessLo, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 v1 = _mm256_shuffle_ps(xyLo, brightnessLo, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 v2 = _mm256_shuffle_ps(xyHi, brightnessHi, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 v3 = _mm256_shuffle_ps(xyHi, brightnessHi, _MM_SHUFFLE(3, 2, 3, 2));
+        vertices[0] = _mm256_castps256_ps128(v0);
+        vertices[1] = _mm256_castps256_ps128(v1);
+        vertices[2] = _mm256_castps256_ps128(v2);
+        vertices[3] = _mm256_castps256_ps128(v3);
+        vertices[4] = _mm256_extractf128_ps(v0, 1);
+        vertices[5] = _mm256_extractf128_ps(v1, 1);
+        vertices[6] = _mm256_extractf128_ps(v2, 1);
+        vertices[7] = _mm256_extractf128_ps(v3, 1);
+    }
+
+    SIMD_TARGET("sse2")
+    void BuildQuadsSse2(const Arrays& lines, size_t numLines, float halfWidth, float scaleX,
+                        float scaleY, Vertex* out) {
+        constexpr int Lanes = 4;
+
+        const __m128 signMask = _mm_set1_ps(-0.f);
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 minPixelDist = _mm_set1_ps(MinPixelDist);
+        const __m128 maxDotLength = _mm_set1_ps(MaxDotLength);
+        const __m128 hw = _mm_set1_ps(halfWidth);
+        const __m128 negHw = _mm_set1_ps(-halfWidth);
+        const __m128 sx = _mm_set1_ps(scaleX);
+        const __m128 sy = _mm_set1_ps(scaleY);
+
+        // SSE2 has no blendv
+        auto Select = [](__m128 mask, __m128 a, __m128 b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        };
+
+        size_t i = 0;
+        for (; i + Lanes <= numLines; i += Lanes) {
+            const __m128 x0 = _mm_loadu_ps(lines.x0 + i);
+            const __m128 y0 = _mm_loadu_ps(lines.y0 + i);
+            const __m128 x1 = _mm_loadu_ps(lines.x1 + i);
+            const __m128 y1 = _mm_loadu_ps(lines.y1 + i);
+
+            const __m128 ux = _mm_sub_ps(x1, x0);
+            const __m128 uy = _mm_sub_ps(y1, y0);
+            const __m128 isDot = _mm_cmple_ps(
+                _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy))), maxDotLength);
+
+            const __m128 p0x = _mm_mul_ps(x0, sx);
+            const __m128 p0y = _mm_mul_ps(y0, sy);
+            __m128 p1x = _mm_mul_ps(x1, sx);
+            __m128 p1y = _mm_mul_ps(y1, sy);
+
+            // Dot lanes divide by 0 here, and are replaced below
+            const __m128 vx = _mm_sub_ps(p1x, p0x);
+            const __m128 vy = _mm_sub_ps(p1y, p0y);
+            const __m128 invLength = _mm_div_ps(
+                one, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy))));
+            const __m128 nx = _mm_mul_ps(vx, invLength);
+            const __m128 ny = _mm_mul_ps(vy, invLength);
+
+            const __m128 shortX = _mm_cmplt_ps(_mm_andnot_ps(signMask, vx), minPixelDist);
+            const __m128 shortY = _mm_cmplt_ps(_mm_andnot_ps(signMask, vy), minPixelDist);
+            p1x = Select(shortX, _mm_add_ps(p0x, _mm_mul_ps(nx, minPixelDist)), p1x);
+            p1y = Select(shortY, _mm_add_ps(p0y, _mm_mul_ps(ny, minPixelDist)), p1y);
+
+            __m128 offsetAX = _mm_mul_ps(_mm_xor_ps(ny, signMask), hw);
+            __m128 offsetAY = _mm_mul_ps(nx, hw);
+            __m128 offsetBX = _mm_xor_ps(offsetAX, signMask);
+            __m128 offsetBY = _mm_xor_ps(offsetAY, signMask);
+
+            p1x = Select(isDot, p0x, p1x);
+            p1y = Select(isDot, p0y, p1y);
+            offsetAX = Select(isDot, hw, offsetAX);
+            offsetAY = Select(isDot, hw, offsetAY);
+            offsetBX = Select(isDot, hw, offsetBX);
+            offsetBY = Select(isDot, negHw, offsetBY);
+
+            const __m128 brightness = _mm_loadu_ps(lines.brightness + i);
+            const __m128 brightnessLo = _mm_unpacklo_ps(brightness, brightness);
+            const __m128 brightnessHi = _mm_unpackhi_ps(brightness, brightness);
+            __m128 a[Lanes], b[Lanes], c[Lanes], d[Lanes];
+            InterleaveSse2(_mm_add_ps(p0x, offsetAX), _mm_add_ps(p0y, offsetAY), brightnessLo,
+                           brightnessHi, a);
+            InterleaveSse2(_mm_add_ps(p0x, offsetBX), _mm_add_ps(p0y, offsetBY), brightnessLo,
+                           brightnessHi, b);
+            InterleaveSse2(_mm_sub_ps(p1x, offsetAX), _mm_sub_ps(p1y, offsetAY), brightnessLo,
+                           brightnessHi, c);
+            InterleaveSse2(_mm_sub_ps(p1x, offsetBX), _mm_sub_ps(p1y, offsetBY), brightnessLo,
+                           brightnessHi, d);
+            for (int l = 0; l < Lanes; ++l)
+                StoreQuad(a[l], b[l], c[l], d[l], out + (i + l) * 6);
+        }
+
+        for (; i < numLines; ++i)
+            BuildQuad(lines, i, halfWidth, scaleX, scaleY, out + i * 6);
+    }
+
+    SIMD_TARGET("sse2")
+    size_t BuildLinesAndPointsSse2(const Arrays& lines, size_t numLines, float scaleX,
+                                   float scaleY, Vertex* lineOut, Vertex* pointOut) {
+        constexpr int Lanes = 4;
+
+        const __m128 signMask = _mm_set1_ps(-0.f);
+        const __m128 epsilon = _mm_set1_ps(PointEpsilon);
+        const __m128 sx = _mm_set1_ps(scaleX);
+        const __m128 sy = _mm_set1_ps(scaleY);
+
+        LineBatch<Lanes> batch;
+        size_t numPoints = 0;
+        size_t i = 0;
+        for (; i + Lanes <= numLines; i += Lanes) {
+            const __m128 p0x = _mm_mul_ps(_mm_loadu_ps(lines.x0 + i), sx);
+            const __m128 p0y = _mm_mul_ps(_mm_loadu_ps(lines.y0 + i), sy);
+            const __m128 p1x = _mm_mul_ps(_mm_loadu_ps(lines.x1 + i), sx);
+            const __m128 p1y = _mm_mul_ps(_mm_loadu_ps(lines.y1 + i), sy);
+
+            const __m128 closeX =
+                _mm_cmple_ps(_mm_andnot_ps(signMask, _mm_sub_ps(p0x, p1x)), epsilon);
+            const __m128 closeY =
+                _mm_cmple_ps(_mm_andnot_ps(signMask, _mm_sub_ps(p0y, p1y)), epsilon);
+
+            _mm_store_ps(batch.p0x, p0x);
+            _mm_store_ps(batch.p0y, p0y);
+            _mm_store_ps(batch.p1x, p1x);
+            _mm_store_ps(batch.p1y, p1y);
+            _mm_store_ps(batch.brightness, _mm_loadu_ps(lines.brightness + i));
+            numPoints += batch.Write(_mm_movemask_ps(_mm_and_ps(closeX, closeY)), lineOut,
+                                     pointOut + numPoints);
+        }
+
+        for (; i < numLines; ++i) {
+            if (BuildLineOrPoint(lines, i, scaleX, scaleY, lineOut, pointOut + numPoints))
+                ++numPoints;
+            else
+                lineOut += 2;
+        }
+        return numPoints;
+    }
+
+    SIMD_TARGET("avx2")
+    void BuildQuadsAvx2(const Arrays& lines, size_t numLines, float halfWidth, float scaleX,
+                        float scaleY, Vertex* out) {
+        constexpr int Lanes = 8;
+
+        const __m256 signMask = _mm256_set1_ps(-0.f);
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 minPixelDist = _mm256_set1_ps(MinPixelDist);
+        const __m256 maxDotLength = _mm256_set1_ps(MaxDotLength);
+        const __m256 hw = _mm256_set1_ps(halfWidth);
+        const __m256 negHw = _mm256_set1_ps(-halfWidth);
+        const __m256 sx = _mm256_set1_ps(scaleX);
+        const __m256 sy = _mm256_set1_ps(scaleY);
+
+        size_t i = 0;
+        for (; i + Lanes <= numLines; i += Lanes) {
+            const __m256 x0 = _mm256_loadu_ps(lines.x0 + i);
+            const __m256 y0 = _mm256_loadu_ps(lines.y0 + i);
+            const __m256 x1 = _mm256_loadu_ps(lines.x1 + i);
+            const __m256 y1 = _mm256_loadu_ps(lines.y1 + i);
+
+            const __m256 ux = _mm256_sub_ps(x1, x0);
+            const __m256 uy = _mm256_sub_ps(y1, y0);
+            const __m256 isDot = _mm256_cmp_ps(
+                _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(ux, ux), _mm256_mul_ps(uy, uy))),
+                maxDotLength, _CMP_LE_OQ);
+
+            const __m256 p0x = _mm256_mul_ps(x0, sx);
+            const __m256 p0y = _mm256_mul_ps(y0, sy);
+            __m256 p1x = _mm256_mul_ps(x1, sx);
+            __m256 p1y = _mm256_mul_ps(y1, sy);
+
+            // Dot lanes divide by 0 here, and are replaced below
+            const __m256 vx = _mm256_sub_ps(p1x, p0x);
+            const __m256 vy = _mm256_sub_ps(p1y, p0y);
+            const __m256 invLength = _mm256_div_ps(
+                one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy))));
+            const __m256 nx = _mm256_mul_ps(vx, invLength);
+            const __m256 ny = _mm256_mul_ps(vy, invLength);
+
+            const __m256 shortX =
+                _mm256_cmp_ps(_mm256_andnot_ps(signMask, vx), minPixelDist, _CMP_LT_OQ);
+            const __m256 shortY =
+                _mm256_cmp_ps(_mm256_andnot_ps(signMask, vy), minPixelDist, _CMP_LT_OQ);
+            p1x = _mm256_blendv_ps(p1x, _mm256_add_ps(p0x, _mm256_mul_ps(nx, minPixelDist)),
+                                   shortX);
+            p1y = _mm256_blendv_ps(p1y, _mm256_add_ps(p0y, _mm256_mul_ps(ny, minPixelDist)),
+                                   shortY);
+
+            __m256 offsetAX = _mm256_mul_ps(_mm256_xor_ps(ny, signMask), hw);
+            __m256 offsetAY = _mm256_mul_ps(nx, hw);
+            __m256 offsetBX = _mm256_xor_ps(offsetAX, signMask);
+            __m256 offsetBY = _mm256_xor_ps(offsetAY, signMask);
+
+            p1x = _mm256_blendv_ps(p1x, p0x, isDot);
+            p1y = _mm256_blendv_ps(p1y, p0y, isDot);
+            offsetAX = _mm256_blendv_ps(offsetAX, hw, isDot);
+            offsetAY = _mm256_blendv_ps(offsetAY, hw, isDot);
+            offsetBX = _mm256_blendv_ps(offsetBX, hw, isDot);
+            offsetBY = _mm256_blendv_ps(offsetBY, negHw, isDot);
+
+            const __m256 brightness = _mm256_loadu_ps(lines.brightness + i);
+            const __m256 brightnessLo = _mm256_unpacklo_ps(brightness, brightness);
+            const __m256 brightnessHi = _mm256_unpackhi_ps(brightness, brightness);
+            __m128 a[Lanes], b[Lanes], c[Lanes], d[Lanes];
+            InterleaveAvx2(_mm256_add_ps(p0x, offsetAX), _mm256_add_ps(p0y, offsetAY),
+                           brightnessLo, brightnessHi, a);
+            InterleaveAvx2(_mm256_add_ps(p0x, offsetBX), _mm256_add_ps(p0y, offsetBY),
+                           brightnessLo, brightnessHi, b);
+            InterleaveAvx2(_mm256_sub_ps(p1x, offsetAX), _mm256_sub_ps(p1y, offsetAY),
+                           brightnessLo, brightnessHi, c);
+            InterleaveAvx2(_mm256_sub_ps(p1x, offsetBX), _mm256_sub_ps(p1y, offsetBY),
+                           brightnessLo, brightnessHi, d);
+            for (int l = 0; l < Lanes; ++l)
+                StoreQuad(a[l], b[l], c[l], d[l], out + (i + l) * 6);
+        }
+        // GCC doesn't insert this before the scalar tail
+        _mm256_zeroupper();
+
+        for (; i < numLines; ++i)
+            BuildQuad(lines, i, halfWidth, scaleX, scaleY, out + i * 6);
+    }
+
+    SIMD_TARGET("avx2")
+    size_t BuildLinesAndPointsAvx2(const Arrays& lines, size_t numLines, float scaleX,
+                                   float scaleY, Vertex* lineOut, Vertex* pointOut) {
+        constexpr int Lanes = 8;
+
+        const __m256 signMask = _mm256_set1_ps(-0.f);
+        const __m256 epsilon = _mm256_set1_ps(PointEpsilon);
+        const __m256 sx = _mm256_set1_ps(scaleX);
+        const __m256 sy = _mm256_set1_ps(scaleY);
+
+        LineBatch<Lanes> batch;
+        size_t numPoints = 0;
+        size_t i = 0;
+        for (; i + Lanes <= numLines; i += Lanes) {
+            const __m256 p0x = _mm256_mul_ps(_mm256_loadu_ps(lines.x0 + i), sx);
+            const __m256 p0y = _mm256_mul_ps(_mm256_loadu_ps(lines.y0 + i), sy);
+            const __m256 p1x = _mm256_mul_ps(_mm256_loadu_ps(lines.x1 + i), sx);
+            const __m256 p1y = _mm256_mul_ps(_mm256_loadu_ps(lines.y1 + i), sy);
+
+            const __m256 closeX = _mm256_cmp_ps(
+                _mm256_andnot_ps(signMask, _mm256_sub_ps(p0x, p1x)), epsilon, _CMP_LE_OQ);
+            const __m256 closeY = _mm256_cmp_ps(
+                _mm256_andnot_ps(signMask, _mm256_sub_ps(p0y, p1y)), epsilon, _CMP_LE_OQ);
+
+            _mm256_store_ps(batch.p0x, p0x);
+            _mm256_store_ps(batch.p0y, p0y);
+            _mm256_store_ps(batch.p1x, p1x);
+            _mm256_store_ps(batch.p1y, p1y);
+            _mm256_store_ps(batch.brightness, _mm256_loadu_ps(lines.brightness + i));
+            numPoints += batch.Write(_mm256_movemask_ps(_mm256_and_ps(closeX, closeY)), lineOut,
+                                     pointOut + numPoints);
+        }
+        _mm256_zeroupper();
+
+        for (; i < numLines; ++i) {
+            if (BuildLineOrPoint(lines, i, scaleX, scaleY, lineOut, pointOut + numPoints))
+                ++numPoints;
+            else
+                lineOut += 2;
+        }
+        return numPoints;
+    }
+#endif
+
+    // Grows buffer to at least size, never shrinking it
+    void Reserve(std::vector<Vertex>& buffer, size_t size) {
+        if (buffer.size() < size)
+            buffer.resize(size);
+    }
+} // namespace
+
+LineVertices::LineVertices() {
+    SetSimd(SoftRender::BestSimd());
+}
+
+void LineVertices::SetSimd(SoftRender::Simd simd) {
+    m_simd = std::min(simd, SoftRender::BestSimd());
+    switch (m_simd) {
+    case SoftRender::Simd::Scalar:
+        m_buildQuads = &BuildQuadsScalar;
+        m_buildLinesAndPoints = &BuildLinesAndPointsScalar;
+        break;
+#ifdef SOFT_RENDER_X86
+    case SoftRender::Simd::Sse2:
+        m_buildQuads = &BuildQuadsSse2;
+        m_buildLinesAndPoints = &BuildLinesAndPointsSse2;
+        break;
+    case SoftRender::Simd::Avx2:
+        m_buildQuads = &BuildQuadsAvx2;
+        m_buildLinesAndPoints = &BuildLinesAndPointsAvx2;
+        break;
+#else
+    default:
+        FAIL();
+#endif
+    }
+}
+
+LineBuffer::Arrays LineVertices::ToArrays(const LineBuffer& lines) {
+    if (lines.GetLayout() == LineBuffer::Layout::Arrays)
+        return lines.GetArrays();
+
+    const size_t numLines = lines.Size();
+    for (auto* array : {&m_x0, &m_y0, &m_x1, &m_y1, &m_brightness}) {
+        if (array->size() < numLines)
+            array->resize(numLines);
+    }
+
+    const Line* source = lines.GetLines();
+    for (size_t i = 0; i < numLines; ++i) {
+        m_x0[i] = source[i].p0.x;
+        m_y0[i] = source[i].p0.y;
+        m_x1[i] = source[i].p1.x;
+        m_y1[i] = source[i].p1.y;
+        m_brightness[i] = source[i].brightness;
+    }
+    return {m_x0.data(), m_y0.data(), m_x1.data(), m_y1.data(), m_brightness.data()};
+}
+
+void LineVertices::BuildQuads(const LineBuffer& lines, float lineWidth, float scaleX,
+                              float scaleY) {
+    const size_t numLines = lines.Size();
+    m_numQuadVertices = numLines * 6;
+    // Plus one for SIMD stores to spill into
+    Reserve(m_quads, m_numQuadVertices + 1);
+
+    // Make sure line width is at least one pixel wide to ensure it gets rendered
+    const float halfWidth = std::max(lineWidth, MinPixelDist) / 2.f;
+    m_buildQuads(ToArrays(lines), numLines, halfWidth, scaleX, scaleY, m_quads.data());
+}
+
+void LineVertices::BuildLinesAndPoints(const LineBuffer& lines, float scaleX, float scaleY) {
+    const size_t numLines = lines.Size();
+    Reserve(m_lines, numLines * 2);
+    Reserve(m_points, numLines);
+
+    const size_t numPoints = m_buildLinesAndPoints(ToArrays(lines), numLines, scaleX, scaleY,
+                                                   m_lines.data(), m_points.data());
+    m_numPointVertices = numPoints;
+    m_numLineVertices = (numLines - numPoints) * 2;
+}
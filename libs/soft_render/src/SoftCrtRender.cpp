@@ -0,0 +1,549 @@
+#include "soft_render/SoftCrtRender.h"
+#include "Simd.h"
+#include "core/ErrorHandler.h"
+#include "core/ImageUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    constexpr int BandHeight = 32; // Rows per unit of work handed to threads
+
+    // Same as Glow.frag's. Weights are symmetric, so taps with the same weight are added before
+    // being weighted.
+    constexpr int NumGlowTaps = 9;
+    constexpr int CenterGlowTap = NumGlowTaps / 2;
+    constexpr float GlowWeights[NumGlowTaps] = {0.0162162162f, 0.0540540541f, 0.1216216216f,
+                                                0.1945945946f, 0.2270270270f, 0.1945945946f,
+                                                0.1216216216f, 0.0540540541f, 0.0162162162f};
+
+    // Same as DarkenTexture.frag's: pixels decay to 1% in 1 / DarkenSpeedScale seconds, and are
+    // cleared once at or below 0.1
+    constexpr float DarkenRate = 0.99f;
+    constexpr float DarkenThreshold = 0.1f;
+
+    // Offsets of the texels Glow.frag samples with nearest filtering, for a step of stepPixels
+    std::array<int, NumGlowTaps> GlowTapOffsets(float stepPixels) {
+        std::array<int, NumGlowTaps> offsets{};
+        for (int i = 0; i < NumGlowTaps; ++i) {
+            offsets[i] = static_cast<int>(std::floor(0.5f + (i - CenterGlowTap) * stepPixels));
+        }
+        return offsets;
+    }
+
+    // Kernels work on rows of count pixels, and each has the same interface for all instruction
+    // sets. SIMD versions handle pixels that don't fill a register with the scalar version.
+    struct KernelSet {
+        // Decays pixels by keep
+        void (*darken)(float* pixels, int count, float keep);
+
+        // Horizontal glow of a row, with tap offsets in pixels, clamped to the row
+        void (*glowRow)(const float* in, float* out, int count, const int* offsets);
+
+        // Vertical glow of a row, with a pointer to each tap's row
+        void (*glowColumns)(const float* const* taps, float* out, int count);
+
+        void (*max)(const float* a, const float* b, float* out, int count);
+
+        // out = a + (b - a) * ratio
+        void (*mix)(const float* a, const float* b, const float* ratio, float* out, int count);
+    };
+
+    namespace Scalar {
+        void Darken(float* pixels, int count, float keep) {
+            for (int i = 0; i < count; ++i)
+                pixels[i] = pixels[i] > DarkenThreshold ? pixels[i] * keep : 0.f;
+        }
+
+        float GlowPixel(const float* in, int x, int count, const int* offsets) {
+            auto Tap = [&](int t) { return in[std::clamp(x + offsets[t], 0, count - 1)]; };
+            float sum = Tap(CenterGlowTap) * GlowWeights[CenterGlowTap];
+            for (int t = 0; t < CenterGlowTap; ++t)
+                sum += (Tap(t) + Tap(NumGlowTaps - 1 - t)) * GlowWeights[t];
+            return sum;
+        }
+
+        void GlowRow(const float* in, float* out, int count, const int* offsets) {
+            for (int x = 0; x < count; ++x)
+                out[x] = GlowPixel(in, x, count, offsets);
+        }
+
+        void GlowColumns(const float* const* taps, float* out, int count) {
+            for (int x = 0; x < count; ++x) {
+                float sum = taps[CenterGlowTap][x] * GlowWeights[CenterGlowTap];
+                for (int t = 0; t < CenterGlowTap; ++t)
+                    sum += (taps[t][x] + taps[NumGlowTaps - 1 - t][x]) * GlowWeights[t];
+                out[x] = sum;
+            }
+        }
+
+        void Max(const float* a, const float* b, float* out, int count) {
+            for (int i = 0; i < count; ++i)
+                out[i] = std::max(a[i], b[i]);
+        }
+
+        void Mix(const float* a, const float* b, const float* ratio, float* out, int count) {
+            for (int i = 0; i < count; ++i)
+                out[i] = a[i] + (b[i] - a[i]) * ratio[i];
+        }
+
+        constexpr KernelSet Kernels{Darken, GlowRow, GlowColumns, Max, Mix};
+    } // namespace Scalar
+
+#ifdef SOFT_RENDER_X86
+    // Pixels whose taps are all within the row, so that they can be loaded without clamping
+    void GlowInteriorRange(int count, const int* offsets, int& first, int& last) {
+        first = std::max(-offsets[0], 0);
+        last = count - 1 - std::max(offsets[NumGlowTaps - 1], 0);
+    }
+
+    namespace Sse2 {
+        constexpr int Lanes = 4;
+
+        SIMD_TARGET("sse2")
+        void Darken(float* pixels, int count, float keep) {
+            const __m128 threshold = _mm_set1_ps(DarkenThreshold);
+            const __m128 keepV = _mm_set1_ps(keep);
+            int i = 0;
+            for (; i + Lanes <= count; i += Lanes) {
+                const __m128 v = _mm_loadu_ps(pixels + i);
+                const __m128 lit = _mm_cmpgt_ps(v, threshold);
+                _mm_storeu_ps(pixels + i, _mm_and_ps(lit, _mm_mul_ps(v, keepV)));
+            }
+            Scalar::Darken(pixels + i, count - i, keep);
+        }
+
+        SIMD_TARGET("sse2")
+        void GlowRow(const float* in, float* out, int count, const int* offsets) {
+            int first{}, last{};
+            GlowInteriorRange(count, offsets, first, last);
+            __m128 weights[CenterGlowTap + 1];
+            for (int t = 0; t <= CenterGlowTap; ++t)
+                weights[t] = _mm_set1_ps(GlowWeights[t]);
+
+            int x = 0;
+            for (; x < std::min(first, count); ++x)
+                out[x] = Scalar::GlowPixel(in, x, count, offsets);
+            for (; x + Lanes - 1 <= last; x += Lanes) {
+                __m128 sum = _mm_mul_ps(_mm_loadu_ps(in + x + offsets[CenterGlowTap]),
+                                        weights[CenterGlowTap]);
+                for (int t = 0; t < CenterGlowTap; ++t) {
+                    const __m128 left = _mm_loadu_ps(in + x + offsets[t]);
+                    const __m128 right = _mm_loadu_ps(in + x + offsets[NumGlowTaps - 1 - t]);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_add_ps(left, right), weights[t]));
+                }
+                _mm_storeu_ps(out + x, sum);
+            }
+            for (; x < count; ++x)
+                out[x] = Scalar::GlowPixel(in, x, count, offsets);
+        }
+
+        SIMD_TARGET("sse2")
+        void GlowColumns(const float* const* taps, float* out, int count) {
+            __m128 weights[CenterGlowTap + 1];
+            for (int t = 0; t <= CenterGlowTap; ++t)
+                weights[t] = _mm_set1_ps(GlowWeights[t]);
+
+            int x = 0;
+            for (; x + Lanes <= count; x += Lanes) {
+                __m128 sum = _mm_mul_ps(_mm_loadu_ps(taps[CenterGlowTap] + x),
+                                        weights[CenterGlowTap]);
+                for (int t = 0; t < CenterGlowTap; ++t) {
+                    const __m128 left = _mm_loadu_ps(taps[t] + x);
+                    const __m128 right = _mm_loadu_ps(taps[NumGlowTaps - 1 - t] + x);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_add_ps(left, right), weights[t]));
+                }
+                _mm_storeu_ps(out + x, sum);
+            }
+            const float* tailTaps[NumGlowTaps];
+            for (int t = 0; t < NumGlowTaps; ++t)
+                tailTaps[t] = taps[t] + x;
+            Scalar::GlowColumns(tailTaps, out + x, count - x);
+        }
+
+        SIMD_TARGET("sse2")
+        void Max(const float* a, const float* b, float* out, int count) {
+            int i = 0;
+            for (; i + Lanes <= count; i += Lanes)
+                _mm_storeu_ps(out + i, _mm_max_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            Scalar::Max(a + i, b + i, out + i, count - i);
+        }
+
+        SIMD_TARGET("sse2")
+        void Mix(const float* a, const float* b, const float* ratio, float* out, int count) {
+            int i = 0;
+            for (; i + Lanes <= count; i += Lanes) {
+                const __m128 av = _mm_loadu_ps(a + i);
+                const __m128 diff = _mm_sub_ps(_mm_loadu_ps(b + i), av);
+                _mm_storeu_ps(out + i, _mm_add_ps(av, _mm_mul_ps(diff, _mm_loadu_ps(ratio + i))));
+            }
+            Scalar::Mix(a + i, b + i, ratio + i, out + i, count - i);
+        }
+
+        constexpr KernelSet Kernels{Darken, GlowRow, GlowColumns, Max, Mix};
+    } // namespace Sse2
+
+    // GCC doesn't always clear the upper halves of the registers before the scalar tails and
+    // returns, which slows down the SSE code that follows, so the kernels do it explicitly
+    namespace Avx2 {
+        constexpr int Lanes = 8;
+
+        SIMD_TARGET("avx2")
+        void Darken(float* pixels, int count, float keep) {
+            const __m256 threshold = _mm256_set1_ps(DarkenThreshold);
+            const __m256 keepV = _mm256_set1_ps(keep);
+            int i = 0;
+            for (; i + Lanes <= count; i += Lanes) {
+                const __m256 v = _mm256_loadu_ps(pixels + i);
+                const __m256 lit = _mm256_cmp_ps(v, threshold, _CMP_GT_OQ);
+                _mm256_storeu_ps(pixels + i, _mm256_and_ps(lit, _mm256_mul_ps(v, keepV)));
+            }
+            _mm256_zeroupper();
+            Scalar::Darken(pixels + i, count - i, keep);
+        }
+
+        SIMD_TARGET("avx2")
+        void GlowRow(const float* in, float* out, int count, const int* offsets) {
+            int first{}, last{};
+            GlowInteriorRange(count, offsets, first, last);
+            __m256 weights[CenterGlowTap + 1];
+            for (int t = 0; t <= CenterGlowTap; ++t)
+                weights[t] = _mm256_set1_ps(GlowWeights[t]);
+
+            int x = 0;
+            for (; x < std::min(first, count); ++x)
+                out[x] = Scalar::GlowPixel(in, x, count, offsets);
+            for (; x + Lanes - 1 <= last; x += Lanes) {
+                __m256 sum = _mm256_mul_ps(_mm256_loadu_ps(in + x + offsets[CenterGlowTap]),
+                                           weights[CenterGlowTap]);
+                for (int t = 0; t < CenterGlowTap; ++t) {
+                    const __m256 left = _mm256_loadu_ps(in + x + offsets[t]);
+                    const __m256 right = _mm256_loadu_ps(in + x + offsets[NumGlowTaps - 1 - t]);
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_add_ps(left, right), weights[t]));
+                }
+                _mm256_storeu_ps(out + x, sum);
+            }
+            _mm256_zeroupper();
+            for (; x < count; ++x)
+                out[x] = Scalar::GlowPixel(in, x, count, offsets);
+        }
+
+        SIMD_TARGET("avx2")
+        void GlowColumns(const float* const* taps, float* out, int count) {
+            __m256 weights[CenterGlowTap + 1];
+            for (int t = 0; t <= CenterGlowTap; ++t)
+                weights[t] = _mm256_set1_ps(GlowWeights[t]);
+
+            int x = 0;
+            for (; x + Lanes <= count; x += Lanes) {
+                __m256 sum = _mm256_mul_ps(_mm256_loadu_ps(taps[CenterGlowTap] + x),
+                                           weights[CenterGlowTap]);
+                for (int t = 0; t < CenterGlowTap; ++t) {
+                    const __m256 left = _mm256_loadu_ps(taps[t] + x);
+                    const __m256 right = _mm256_loadu_ps(taps[NumGlowTaps - 1 - t] + x);
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_add_ps(left, right), weights[t]));
+                }
+                _mm256_storeu_ps(out + x, sum);
+            }
+            _mm256_zeroupper();
+            const float* tailTaps[NumGlowTaps];
+            for (int t = 0; t < NumGlowTaps; ++t)
+                tailTaps[t] = taps[t] + x;
+            Scalar::GlowColumns(tailTaps, out + x, count - x);
+        }
+
+        SIMD_TARGET("avx2")
+        void Max(const float* a, const float* b, float* out, int count) {
+            int i = 0;
+            for (; i + Lanes <= count; i += Lanes) {
+                _mm256_storeu_ps(out + i,
+                                 _mm256_max_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            }
+            _mm256_zeroupper();
+            Scalar::Max(a + i, b + i, out + i, count - i);
+        }
+
+        SIMD_TARGET("avx2")
+        void Mix(const float* a, const float* b, const float* ratio, float* out, int count) {
+            int i = 0;
+            for (; i + Lanes <= count; i += Lanes) {
+                const __m256 av = _mm256_loadu_ps(a + i);
+                const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(b + i), av);
+                const __m256 ratioV = _mm256_loadu_ps(ratio + i);
+                _mm256_storeu_ps(out + i, _mm256_add_ps(av, _mm256_mul_ps(diff, ratioV)));
+            }
+            _mm256_zeroupper();
+            Scalar::Mix(a + i, b + i, ratio + i, out + i, count - i);
+        }
+
+        constexpr KernelSet Kernels{Darken, GlowRow, GlowColumns, Max, Mix};
+    } // namespace Avx2
+#endif
+
+    const KernelSet& GetKernels(SoftRender::Simd simd) {
+        switch (simd) {
+#ifdef SOFT_RENDER_X86
+        case SoftRender::Simd::Sse2:
+            return Sse2::Kernels;
+        case SoftRender::Simd::Avx2:
+            return Avx2::Kernels;
+#endif
+        default:
+            return Scalar::Kernels;
+        }
+    }
+
+    // Rows of band, within numRows
+    template <typename Func>
+    void ForEachBandRow(int band, int numRows, Func func) {
+        const int lastRow = std::min((band + 1) * BandHeight, numRows);
+        for (int y = band * BandHeight; y < lastRow; ++y)
+            func(y);
+    }
+} // namespace
+
+const char* SoftCrtRender::StageName(Stage stage) {
+    switch (stage) {
+    case Stage::Darken:
+        return "darken";
+    case Stage::DrawVectors:
+        return "drawVectors";
+    case Stage::DrawGlowVectors:
+        return "drawGlowVectors";
+    case Stage::Glow:
+        return "glow";
+    case Stage::Combine:
+        return "combine";
+    case Stage::Composite:
+        return "composite";
+    case Stage::Count:
+        break;
+    }
+    return "";
+}
+
+void SoftCrtRender::Init(int screenWidth, int screenHeight, int numThreads) {
+    ASSERT(screenWidth > 0 && screenHeight > 0);
+    m_width = screenWidth;
+    m_height = screenHeight;
+
+    // Same as GLRender::OnWindowResized
+    const int crtWidth = std::max(static_cast<int>(screenWidth * CrtScaleX), 1);
+    const int crtHeight = std::max(static_cast<int>(screenHeight * CrtScaleY), 1);
+    m_crtX = (screenWidth - crtWidth) / 2;
+    m_crtY = (screenHeight - crtHeight) / 2;
+    m_numScreenBands = (screenHeight + BandHeight - 1) / BandHeight;
+    m_numCrtBands = (crtHeight + BandHeight - 1) / BandHeight;
+
+    m_pool.Init(numThreads);
+    m_vectors.Init(crtWidth, crtHeight, m_pool);
+    m_glowVectors.Init(crtWidth, crtHeight, m_pool);
+
+    const size_t crtSize = static_cast<size_t>(crtWidth) * crtHeight;
+    const size_t screenSize = static_cast<size_t>(screenWidth) * screenHeight;
+    m_tempGlow.assign(crtSize, 0.f);
+    m_glow.assign(crtSize, 0.f);
+    m_glowRowLit.assign(crtHeight, false);
+    m_screen.assign(screenSize, 0.f);
+    for (auto& plane : m_output)
+        plane.assign(screenSize, 0.f);
+
+    SetOverlay(nullptr, 0, 0);
+    ResetStageTimes();
+}
+
+void SoftCrtRender::SetSimd(SoftRender::Simd simd) {
+    m_vectors.SetSimd(simd);
+    m_glowVectors.SetSimd(simd);
+}
+
+void SoftCrtRender::SetOverlay(const uint8_t* rgba, int width, int height) {
+    m_hasOverlay = rgba != nullptr && width > 0 && height > 0;
+    if (!m_hasOverlay) {
+        for (auto& plane : m_overlayColor)
+            plane.clear();
+        m_overlayRatio.clear();
+        return;
+    }
+
+    const size_t screenSize = static_cast<size_t>(m_width) * m_height;
+    for (auto& plane : m_overlayColor)
+        plane.resize(screenSize);
+    m_overlayRatio.resize(screenSize);
+
+    // Bilinear filtering, as GLRender loads overlays with GL_LINEAR, clamped to the edges
+    auto Texel = [&](int x, int y, int channel) {
+        x = std::clamp(x, 0, width - 1);
+        y = std::clamp(y, 0, height - 1);
+        return rgba[(static_cast<size_t>(y) * width + x) * 4 + channel] / 255.f;
+    };
+
+    for (int y = 0; y < m_height; ++y) {
+        const float v = (y + 0.5f) * height / m_height - 0.5f;
+        const int y0 = static_cast<int>(std::floor(v));
+        const float fy = v - y0;
+
+        for (int x = 0; x < m_width; ++x) {
+            const float u = (x + 0.5f) * width / m_width - 0.5f;
+            const int x0 = static_cast<int>(std::floor(u));
+            const float fx = u - x0;
+
+            float color[4];
+            for (int c = 0; c < 4; ++c) {
+                auto Row = [&](int texelY) {
+                    const float left = Texel(x0, texelY, c);
+                    return left + (Texel(x0 + 1, texelY, c) - left) * fx;
+                };
+                const float top = Row(y0);
+                color[c] = top + (Row(y0 + 1) - top) * fy;
+            }
+
+            const size_t i = static_cast<size_t>(y) * m_width + x;
+            for (int c = 0; c < 3; ++c)
+                m_overlayColor[c][i] = color[c];
+            // Same as DrawScreen.frag
+            m_overlayRatio[i] = std::max(0.f, color[3] - (1.f - OverlayAlpha));
+        }
+    }
+}
+
+bool SoftCrtRender::LoadOverlay(const char* file) {
+    auto image = ImageUtil::loadPngImage(file);
+    if (!image || image->width <= 0 || image->height <= 0)
+        return false;
+
+    // Images are loaded bottom row first, as GL textures expect, and RGB ones are opaque
+    const int numChannels = image->hasAlpha ? 4 : 3;
+    std::vector<uint8_t> rgba(static_cast<size_t>(image->width) * image->height * 4);
+    for (int y = 0; y < image->height; ++y) {
+        const uint8_t* in =
+            &image->data[static_cast<size_t>(image->height - 1 - y) * image->width * numChannels];
+        uint8_t* out = &rgba[static_cast<size_t>(y) * image->width * 4];
+        for (int x = 0; x < image->width; ++x, in += numChannels, out += 4) {
+            std::copy_n(in, 3, out);
+            out[3] = image->hasAlpha ? in[3] : 255;
+        }
+    }
+
+    SetOverlay(rgba.data(), image->width, image->height);
+    return true;
+}
+
+void SoftCrtRender::Render(double frameTime, const LineBuffer& lines) {
+    if (frameTime > 0)
+        RunStage(Stage::Darken, [&] { Darken(static_cast<float>(frameTime)); });
+    RunStage(Stage::DrawVectors,
+             [&] { m_vectors.DrawLines(lines, SoftRender::LineWidthNormal); });
+    RunStage(Stage::DrawGlowVectors, [&] { m_glowVectors.DrawLines(lines, LineWidthGlow); });
+    RunStage(Stage::Glow, [&] { Glow(); });
+    RunStage(Stage::Combine, [&] { Combine(); });
+    if (m_hasOverlay)
+        RunStage(Stage::Composite, [&] { Composite(); });
+}
+
+void SoftCrtRender::ToRgb8(uint8_t* out) const {
+    auto ToByte = [](float value) {
+        return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+    };
+
+    const size_t screenSize = m_screen.size();
+    for (size_t i = 0; i < screenSize; ++i) {
+        for (int c = 0; c < 3; ++c)
+            out[i * 3 + c] = ToByte(m_hasOverlay ? m_output[c][i] : m_screen[i]);
+    }
+}
+
+template <typename Func>
+void SoftCrtRender::RunStage(Stage stage, Func func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    m_stageSeconds[static_cast<size_t>(stage)] +=
+        std::chrono::duration<double>(end - start).count();
+}
+
+void SoftCrtRender::Darken(float frameTime) {
+    const KernelSet& kernels = GetKernels(GetSimd());
+    const float keep = std::pow(1.f - DarkenRate, frameTime * DarkenSpeedScale);
+    const int crtWidth = m_vectors.Width();
+
+    m_pool.Run(m_numCrtBands, [&](int band) {
+        ForEachBandRow(band, m_vectors.Height(), [&](int y) {
+            const size_t offset = static_cast<size_t>(y) * crtWidth;
+            kernels.darken(m_vectors.Pixels() + offset, crtWidth, keep);
+            kernels.darken(m_glowVectors.Pixels() + offset, crtWidth, keep);
+        });
+    });
+}
+
+void SoftCrtRender::Glow() {
+    const KernelSet& kernels = GetKernels(GetSimd());
+    const int crtWidth = m_glowVectors.Width();
+    const int crtHeight = m_glowVectors.Height();
+
+    // Glow.frag's step is GlowRadius / width in texture coordinates in both directions, so it's
+    // scaled by the aspect ratio vertically
+    const auto rowOffsets = GlowTapOffsets(GlowRadius);
+    const auto columnOffsets = GlowTapOffsets(GlowRadius * crtHeight / crtWidth);
+
+    // Most rows are usually dark, and glow to nothing
+    const float* in = m_glowVectors.Pixels();
+    m_pool.Run(m_numCrtBands, [&](int band) {
+        ForEachBandRow(band, crtHeight, [&](int y) {
+            const size_t offset = static_cast<size_t>(y) * crtWidth;
+            const float* row = in + offset;
+            m_glowRowLit[y] = std::any_of(row, row + crtWidth, [](float v) { return v != 0.f; });
+            if (m_glowRowLit[y]) {
+                kernels.glowRow(row, &m_tempGlow[offset], crtWidth, rowOffsets.data());
+            } else {
+                std::fill_n(&m_tempGlow[offset], crtWidth, 0.f);
+            }
+        });
+    });
+
+    m_pool.Run(m_numCrtBands, [&](int band) {
+        ForEachBandRow(band, crtHeight, [&](int y) {
+            const float* taps[NumGlowTaps];
+            bool lit = false;
+            for (int t = 0; t < NumGlowTaps; ++t) {
+                const int tapY = std::clamp(y + columnOffsets[t], 0, crtHeight - 1);
+                taps[t] = &m_tempGlow[static_cast<size_t>(tapY) * crtWidth];
+                lit = lit || m_glowRowLit[tapY];
+            }
+
+            float* out = &m_glow[static_cast<size_t>(y) * crtWidth];
+            if (lit) {
+                kernels.glowColumns(taps, out, crtWidth);
+            } else {
+                std::fill_n(out, crtWidth, 0.f);
+            }
+        });
+    });
+}
+
+void SoftCrtRender::Combine() {
+    const KernelSet& kernels = GetKernels(GetSimd());
+    const int crtWidth = m_vectors.Width();
+
+    m_pool.Run(m_numCrtBands, [&](int band) {
+        ForEachBandRow(band, m_vectors.Height(), [&](int y) {
+            const size_t offset = static_cast<size_t>(y) * crtWidth;
+            float* screenRow = &m_screen[static_cast<size_t>(y + m_crtY) * m_width + m_crtX];
+            kernels.max(m_vectors.Pixels() + offset, &m_glow[offset], screenRow, crtWidth);
+        });
+    });
+}
+
+void SoftCrtRender::Composite() {
+    const KernelSet& kernels = GetKernels(GetSimd());
+
+    m_pool.Run(m_numScreenBands, [&](int band) {
+        ForEachBandRow(band, m_height, [&](int y) {
+            const size_t offset = static_cast<size_t>(y) * m_width;
+            for (int c = 0; c < 3; ++c) {
+                kernels.mix(&m_screen[offset], &m_overlayColor[c][offset], &m_overlayRatio[offset],
+                            &m_output[c][offset], m_width);
+            }
+        });
+    });
+}
@@ -0,0 +1,283 @@
+#include "soft_render/SoftRender.h"
+#include "Simd.h"
+#include "core/ErrorHandler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr float VectrexScreenWidth = 256.f;
+    constexpr float VectrexScreenHeight = 256.f;
+    constexpr int BandHeight = 32; // Rows per unit of work handed to threads
+
+    // Clamps before converting, as lines can be far off screen
+    int ClampToInt(float value, int min, int max) {
+        return static_cast<int>(
+            std::clamp(value, static_cast<float>(min), static_cast<float>(max)));
+    }
+
+    // Row functions draw pixels [x0, x1] of a row. SIMD versions evaluate pixels the same way as
+    // DrawRowScalar, so that they produce the same results. They're templated on SoftRender's
+    // private Segment type.
+    template <typename Segment>
+    void DrawRowScalar(const Segment& s, float* row, float rowCenterY, int x0, int x1,
+                       int /*width*/) {
+        const float py = rowCenterY - s.y0;
+        for (int x = x0; x <= x1; ++x) {
+            const float px = (static_cast<float>(x) + 0.5f) - s.x0;
+            float t = (px * s.dx + py * s.dy) * s.invLength2;
+            t = std::min(std::max(t, 0.f), 1.f);
+            const float qx = px - s.dx * t;
+            const float qy = py - s.dy * t;
+            const float dist = std::sqrt(qx * qx + qy * qy);
+            const float coverage = std::min(std::max(s.radius - dist, 0.f), 1.f) * s.brightness;
+            row[x] = std::max(row[x], coverage);
+        }
+    }
+
+#ifdef SOFT_RENDER_X86
+    // When the last group of pixels would go past the end of the row, it's moved back to end with
+    // it instead, redrawing a few pixels, which max makes harmless.
+    template <typename Segment>
+    SIMD_TARGET("sse2")
+    void DrawRowSse2(const Segment& s, float* row, float rowCenterY, int x0, int x1, int width) {
+        constexpr int Lanes = 4;
+        if (width < Lanes) {
+            DrawRowScalar(s, row, rowCenterY, x0, x1, width);
+            return;
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 startX = _mm_set1_ps(s.x0);
+        const __m128 dx = _mm_set1_ps(s.dx);
+        const __m128 dy = _mm_set1_ps(s.dy);
+        const __m128 invLength2 = _mm_set1_ps(s.invLength2);
+        const __m128 radius = _mm_set1_ps(s.radius);
+        const __m128 brightness = _mm_set1_ps(s.brightness);
+        const __m128 py = _mm_set1_ps(rowCenterY - s.y0);
+        const __m128 pyDy = _mm_mul_ps(py, dy);
+
+        for (int x = x0; x <= x1; x += Lanes) {
+            const int groupX = std::min(x, width - Lanes);
+            const __m128 px = _mm_sub_ps(
+                _mm_add_ps(_mm_set1_ps(static_cast<float>(groupX)), laneOffsets), startX);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(px, dx), pyDy), invLength2);
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            const __m128 qx = _mm_sub_ps(px, _mm_mul_ps(dx, t));
+            const __m128 qy = _mm_sub_ps(py, _mm_mul_ps(dy, t));
+            const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)));
+            const __m128 coverage = _mm_mul_ps(
+                _mm_min_ps(_mm_max_ps(_mm_sub_ps(radius, dist), zero), one), brightness);
+            _mm_storeu_ps(row + groupX, _mm_max_ps(_mm_loadu_ps(row + groupX), coverage));
+        }
+    }
+
+    template <typename Segment>
+    SIMD_TARGET("avx2")
+    void DrawRowAvx2(const Segment& s, float* row, float rowCenterY, int x0, int x1, int width) {
+        constexpr int Lanes = 8;
+        if (width < Lanes) {
+            DrawRowScalar(s, row, rowCenterY, x0, x1, width);
+            return;
+        }
+
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 laneOffsets =
+            _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 startX = _mm256_set1_ps(s.x0);
+        const __m256 dx = _mm256_set1_ps(s.dx);
+        const __m256 dy = _mm256_set1_ps(s.dy);
+        const __m256 invLength2 = _mm256_set1_ps(s.invLength2);
+        const __m256 radius = _mm256_set1_ps(s.radius);
+        const __m256 brightness = _mm256_set1_ps(s.brightness);
+        const __m256 py = _mm256_set1_ps(rowCenterY - s.y0);
+        const __m256 pyDy = _mm256_mul_ps(py, dy);
+
+        for (int x = x0; x <= x1; x += Lanes) {
+            const int groupX = std::min(x, width - Lanes);
+            const __m256 px = _mm256_sub_ps(
+                _mm256_add_ps(_mm256_set1_ps(static_cast<float>(groupX)), laneOffsets), startX);
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(px, dx), pyDy), invLength2);
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            const __m256 qx = _mm256_sub_ps(px, _mm256_mul_ps(dx, t));
+            const __m256 qy = _mm256_sub_ps(py, _mm256_mul_ps(dy, t));
+            const __m256 dist =
+                _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy)));
+            const __m256 coverage = _mm256_mul_ps(
+                _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(radius, dist), zero), one), brightness);
+            _mm256_storeu_ps(row + groupX, _mm256_max_ps(_mm256_loadu_ps(row + groupX), coverage));
+        }
+    }
+#endif
+} // namespace
+
+SoftRender::Simd SoftRender::BestSimd() {
+#if !defined(SOFT_RENDER_X86)
+    return Simd::Scalar;
+#elif defined(_MSC_VER)
+    int info[4]{};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    // AVX state must also be enabled by the OS
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (osxsave && avx && (_xgetbv(0) & 6) == 6 && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? Simd::Avx2 : sse2 ? Simd::Sse2 : Simd::Scalar;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Simd::Avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return Simd::Sse2;
+    return Simd::Scalar;
+#endif
+}
+
+const char* SoftRender::SimdName(Simd simd) {
+    switch (simd) {
+    case Simd::Scalar:
+        return "scalar";
+    case Simd::Sse2:
+        return "sse2";
+    case Simd::Avx2:
+        return "avx2";
+    }
+    return "";
+}
+
+SoftRender::SoftRender() {
+    SetSimd(BestSimd());
+}
+
+void SoftRender::Init(int width, int height, int numThreads) {
+    if (!m_ownPool)
+        m_ownPool = std::make_unique<BandPool>();
+    m_ownPool->Init(numThreads);
+    Init(width, height, *m_ownPool);
+}
+
+void SoftRender::Init(int width, int height, BandPool& pool) {
+    ASSERT(width > 0 && height > 0);
+    m_width = width;
+    m_height = height;
+    m_pixels.assign(static_cast<size_t>(width) * height, 0.f);
+    m_numBands = (height + BandHeight - 1) / BandHeight;
+    m_pool = &pool;
+}
+
+void SoftRender::SetSimd(Simd simd) {
+    m_simd = std::min(simd, BestSimd());
+    switch (m_simd) {
+    case Simd::Scalar:
+        m_drawRow = &DrawRowScalar<Segment>;
+        break;
+#ifdef SOFT_RENDER_X86
+    case Simd::Sse2:
+        m_drawRow = &DrawRowSse2<Segment>;
+        break;
+    case Simd::Avx2:
+        m_drawRow = &DrawRowAvx2<Segment>;
+        break;
+#else
+    default:
+        FAIL();
+#endif
+    }
+}
+
+void SoftRender::Clear() {
+    std::fill(m_pixels.begin(), m_pixels.end(), 0.f);
+}
+
+void SoftRender::DrawLines(const LineBuffer& lines, float lineWidth) {
+    const float scaleX = m_width / VectrexScreenWidth;
+    const float scaleY = m_height / VectrexScreenHeight;
+    const float centerX = m_width / 2.f;
+    const float centerY = m_height / 2.f;
+
+    // Like GLRender, make sure lines are at least one pixel wide
+    const float radius = std::max(lineWidth * scaleX, 1.f) / 2.f + 0.5f;
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    m_segments.clear();
+    lines.ForEach([&](const Line& line) {
+        if (line.brightness <= 0.f)
+            return;
+
+        Segment s;
+        s.x0 = centerX + line.p0.x * scaleX;
+        s.y0 = centerY - line.p0.y * scaleY;
+        s.radius = radius;
+        s.brightness = line.brightness;
+        s.halfSpan = infinity;
+
+        // Same test as GLRender, before scaling
+        const bool isDot = Magnitude(line.p0 - line.p1) <= 0.1f;
+        if (!isDot) {
+            s.dx = (centerX + line.p1.x * scaleX) - s.x0;
+            s.dy = (centerY - line.p1.y * scaleY) - s.y0;
+            const float length2 = s.dx * s.dx + s.dy * s.dy;
+            s.invLength2 = 1.f / length2;
+
+            // Pixels within radius of the line are within radius * length / |dy| of where it
+            // crosses the row. Nearly horizontal lines are only bound by their bounding box.
+            if (std::abs(s.dy) > 0.01f) {
+                s.dxPerRow = s.dx / s.dy;
+                s.halfSpan = radius * std::sqrt(length2) / std::abs(s.dy);
+            }
+        }
+
+        s.minX = std::min(s.x0, s.x0 + s.dx) - radius;
+        s.maxX = std::max(s.x0, s.x0 + s.dx) + radius;
+        const float minY = std::min(s.y0, s.y0 + s.dy) - radius;
+        const float maxY = std::max(s.y0, s.y0 + s.dy) + radius;
+        if (s.maxX < 0.f || s.minX > m_width || maxY < 0.f || minY > m_height)
+            return;
+
+        s.minRow = ClampToInt(std::floor(minY - 0.5f), 0, m_height - 1);
+        s.maxRow = ClampToInt(std::ceil(maxY - 0.5f), 0, m_height - 1);
+        m_segments.push_back(s);
+    });
+
+    if (!m_segments.empty())
+        m_pool->Run(m_numBands, [this](int band) { DrawBand(band); });
+}
+
+void SoftRender::ToGray8(uint8_t* out) const {
+    for (size_t i = 0; i < m_pixels.size(); ++i) {
+        out[i] = static_cast<uint8_t>(std::min(m_pixels[i], 1.f) * 255.f + 0.5f);
+    }
+}
+
+void SoftRender::DrawBand(int band) {
+    const int firstRow = band * BandHeight;
+    const int lastRow = std::min(firstRow + BandHeight, m_height) - 1;
+
+    for (auto& s : m_segments) {
+        const int segmentFirstRow = std::max(firstRow, s.minRow);
+        const int segmentLastRow = std::min(lastRow, s.maxRow);
+
+        for (int y = segmentFirstRow; y <= segmentLastRow; ++y) {
+            const float rowCenterY = static_cast<float>(y) + 0.5f;
+            const float crossX = s.x0 + (rowCenterY - s.y0) * s.dxPerRow;
+            const float minX = std::max(s.minX, crossX - s.halfSpan);
+            const float maxX = std::min(s.maxX, crossX + s.halfSpan);
+            if (minX > maxX)
+                continue;
+
+            const int x0 = ClampToInt(std::floor(minX - 0.5f), 0, m_width - 1);
+            const int x1 = ClampToInt(std::ceil(maxX - 0.5f), 0, m_width - 1);
+            m_drawRow(s, &m_pixels[static_cast<size_t>(y) * m_width], rowCenterY, x0, x1,
+                      m_width);
+        }
+    }
+}
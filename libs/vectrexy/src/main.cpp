@@ -29,9 +29,15 @@ private:
 
         //@TODO: Clean this up
         std::string rom = "";
-        for (auto& arg : args) {
-            if (arg[0] != '-')
-                rom = arg;
+        for (size_t i = 0; i < args.size(); ++i) {
+            // Skip option values
+            if (args[i] == "-record" || args[i] == "-play" || args[i] == "-softrender" ||
+                args[i] == "-frames" || args[i] == "-screenshot") {
+                ++i;
+                continue;
+            }
+            if (args[i][0] != '-')
+                rom = args[i];
         }
 
         //@TODO: polymorphic IDebugger base class
@@ -140,6 +146,8 @@ private:
 
         bool keepGoing = false;
         if (m_debugger) {
+            // Polled, as it can be changed at any time
+            m_debugger->SetRunAheadFrames(options.Get<int>("runAheadFrames"));
             keepGoing =
                 m_debugger->FrameUpdate(frameTime, emuEvents, input, renderContext, audioContext);
         }
@@ -157,7 +165,10 @@ private:
         return keepGoing;
     }
 
-    void Shutdown() override {}
+    void Shutdown() override {
+        if (m_debugger)
+            m_debugger->Shutdown();
+    }
 
     std::shared_ptr<IEngineService> m_engineService;
     Emulator m_emulator;
@@ -0,0 +1,636 @@
+#include "core/Base.h"
+#include "core/ImageUtil.h"
+#include "debugger/Trace.h"
+#include "emulator/Emulator.h"
+#include "emulator/EngineTypes.h"
+#include "emulator/Movie.h"
+#include "emulator/Profiler.h"
+#include "soft_render/LineVertices.h"
+#include "soft_render/SoftCrtRender.h"
+#include "soft_render/SoftRender.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Headless benchmark: runs a rom as fast as possible, without rendering or audio output, and
+// reports emulation throughput. With -profile, the same run is repeated with the subsystem
+// profiler enabled to report where the time goes. Profiling adds overhead, so throughput is always
+// measured on the unprofiled run.
+//
+// Runs can also be recorded to, or replayed from, a movie (see Movie), e.g. one recorded in the
+// engine with -record. With -hash, the instruction hash is computed the same way the debugger does
+// with trace enabled, so that it can be compared against the one stored in the movie.
+//
+// With -render, the lines of each frame are also drawn with SoftRender, and the time spent doing so
+// is reported separately. With -crt, they're drawn with SoftCrtRender instead, which also applies
+// GLRender's glow, phosphor decay and overlay passes, and the time spent in each is reported.
+//
+// With -vertices, the vertices GLRender would draw each frame's lines with are built with
+// LineVertices, and the time spent doing so is reported separately. This needs no GL context, so
+// vertex building can be measured on its own.
+
+namespace {
+    struct Options {
+        std::string biosRomFile = "data/bios/System.bin";
+        std::string romFile;
+        uint64_t frames = 3000;
+        uint64_t cycles = 0; // If non-zero, used instead of frames
+        bool step = false; // Call ExecuteInstruction for each instruction instead of RunCycles
+        bool skipIdle = true;
+        bool output = true; // Produce lines and audio samples
+        bool profile = false;
+        bool json = false;
+        bool hash = false;
+        std::string recordFile;
+        std::string playFile;
+        int renderWidth = 0; // If non-zero, render with SoftRender
+        int renderHeight = 0;
+        int renderThreads = 0;
+        SoftRender::Simd renderSimd = SoftRender::BestSimd();
+        bool renderCrt = false;
+        std::string overlayFile; // Composited by the CRT renderer, top row first
+        std::string screenshotFile;
+        bool vertices = false;   // Build GLRender's vertices with LineVertices
+        bool lineArrays = false; // Store lines with LineBuffer::Layout::Arrays
+    };
+
+    struct RunStats {
+        double seconds = 0;
+        cycles_t cycles = 0;
+        uint64_t frames = 0;
+        uint64_t instructions = 0;
+        uint64_t lines = 0;
+        uint64_t coalescedLines = 0; // Not in lines, see Screen::LineStats
+        uint64_t dedupedDots = 0;
+        uint64_t audioSamples = 0;
+        uint32_t instructionHash = 0;
+        double renderSeconds = 0;
+        uint64_t vertices = 0;
+        double vertexSeconds = 0;
+    };
+
+    constexpr double FramesPerSecond = 50.0;
+    constexpr double CyclesPerFrame = Cpu::Hz / FramesPerSecond;
+    constexpr float AudioSampleRate = 44100.0f;
+    constexpr unsigned int RamSeed = 0; // Fixed so that runs are reproducible
+    constexpr int DefaultRenderWidth = 1024;
+    constexpr int DefaultRenderHeight = 1280;
+    constexpr SoftRender::Simd AllSimd[] = {SoftRender::Simd::Scalar, SoftRender::Simd::Sse2,
+                                            SoftRender::Simd::Avx2};
+
+    void PrintUsage() {
+        printf("Usage: vectrexy_bench [options] [rom]\n"
+               "  -bios <file>    BIOS rom to load (default: data/bios/System.bin)\n"
+               "  -frames <n>     Number of frames to emulate (default: 3000)\n"
+               "  -cycles <n>     Number of cpu cycles to emulate, instead of frames\n"
+               "  -step           Execute one instruction per call instead of using RunCycles\n"
+               "  -noidleskip     Execute idle loops instruction by instruction (implies -step)\n"
+               "  -nooutput       Don't produce lines or audio samples, as when fast-forwarding\n"
+               "  -profile        Also report time spent per subsystem\n"
+               "  -json           Output results as JSON\n"
+               "  -record <file>  Record the run to a movie file\n"
+               "  -play <file>    Replay a movie file (its frame count overrides -frames)\n"
+               "  -hash           Compute the instruction hash (implies -step, slow)\n"
+               "  -render <w>x<h> Render frames with the software renderer at this resolution\n"
+               "  -renderthreads <n>  Threads to render with (default: one per hardware thread)\n"
+               "  -simd <name>    Software renderer instruction set: scalar, sse2 or avx2\n"
+               "  -crt            Also apply the CRT glow, decay and overlay passes\n"
+               "  -overlay <file> Overlay png for -crt\n"
+               "  -screenshot <file>  Save the last rendered frame as a png (implies -render)\n"
+               "  -vertices       Build GLRender's line vertices for each frame (uses -simd)\n"
+               "  -linearrays     Store lines as separate coordinate arrays\n");
+    }
+
+    bool ParseArgs(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (strcmp(arg, "-bios") == 0 && hasValue) {
+                options.biosRomFile = argv[++i];
+            } else if (strcmp(arg, "-frames") == 0 && hasValue) {
+                options.frames = std::strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(arg, "-cycles") == 0 && hasValue) {
+                options.cycles = std::strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(arg, "-step") == 0) {
+                options.step = true;
+            } else if (strcmp(arg, "-noidleskip") == 0) {
+                options.step = true;
+                options.skipIdle = false;
+            } else if (strcmp(arg, "-nooutput") == 0) {
+                options.output = false;
+            } else if (strcmp(arg, "-profile") == 0) {
+                options.profile = true;
+            } else if (strcmp(arg, "-json") == 0) {
+                options.json = true;
+            } else if (strcmp(arg, "-record") == 0 && hasValue) {
+                options.recordFile = argv[++i];
+            } else if (strcmp(arg, "-play") == 0 && hasValue) {
+                options.playFile = argv[++i];
+            } else if (strcmp(arg, "-hash") == 0) {
+                options.step = true;
+                options.hash = true;
+            } else if (strcmp(arg, "-render") == 0 && hasValue) {
+                if (sscanf(argv[++i], "%dx%d", &options.renderWidth, &options.renderHeight) != 2 ||
+                    options.renderWidth <= 0 || options.renderHeight <= 0)
+                    return false;
+            } else if (strcmp(arg, "-renderthreads") == 0 && hasValue) {
+                options.renderThreads = atoi(argv[++i]);
+            } else if (strcmp(arg, "-simd") == 0 && hasValue) {
+                const char* name = argv[++i];
+                auto simd = std::find_if(std::begin(AllSimd), std::end(AllSimd), [&](auto simd) {
+                    return strcmp(SoftRender::SimdName(simd), name) == 0;
+                });
+                if (simd == std::end(AllSimd))
+                    return false;
+                options.renderSimd = *simd;
+            } else if (strcmp(arg, "-crt") == 0) {
+                options.renderCrt = true;
+            } else if (strcmp(arg, "-overlay") == 0 && hasValue) {
+                options.renderCrt = true;
+                options.overlayFile = argv[++i];
+            } else if (strcmp(arg, "-screenshot") == 0 && hasValue) {
+                options.screenshotFile = argv[++i];
+            } else if (strcmp(arg, "-vertices") == 0) {
+                options.vertices = true;
+            } else if (strcmp(arg, "-linearrays") == 0) {
+                options.lineArrays = true;
+            } else if (arg[0] != '-') {
+                options.romFile = arg;
+            } else {
+                return false;
+            }
+        }
+        if ((!options.screenshotFile.empty() || options.renderCrt) && options.renderWidth == 0) {
+            options.renderWidth = DefaultRenderWidth;
+            options.renderHeight = DefaultRenderHeight;
+        }
+        return options.frames > 0 || options.cycles > 0;
+    }
+
+    bool ResetEmulator(Emulator& emulator, const Options& options, Movie& movie) {
+        emulator.Init(options.biosRomFile.c_str());
+        if (!emulator.LoadBios(options.biosRomFile.c_str())) {
+            fprintf(stderr, "Failed to load BIOS rom: %s\n", options.biosRomFile.c_str());
+            return false;
+        }
+        if (!options.romFile.empty() && !emulator.LoadRom(options.romFile.c_str())) {
+            fprintf(stderr, "Failed to load rom: %s\n", options.romFile.c_str());
+            return false;
+        }
+
+        if (!options.playFile.empty()) {
+            const auto& header = movie.GetHeader();
+            if (header.biosHash != emulator.BiosHash() || header.romHash != emulator.RomHash())
+                fprintf(stderr, "Warning: movie was recorded with a different BIOS or rom\n");
+            movie.BeginPlayback();
+            emulator.Reset(header.ramSeed);
+        } else {
+            if (!options.recordFile.empty())
+                movie.BeginRecording({RamSeed, emulator.BiosHash(), emulator.RomHash()});
+            emulator.Reset(RamSeed);
+        }
+        return true;
+    }
+
+    // Computes the running hash of executed instructions the same way Debugger::ExecuteInstruction
+    // does with trace enabled
+    class InstructionHasher {
+    public:
+        explicit InstructionHasher(Emulator& emulator)
+            : m_emulator(emulator) {
+            auto OnAccess = [this](bool read) {
+                return [this, read](uint16_t address, uint8_t value) {
+                    if (m_currTraceInfo)
+                        m_currTraceInfo->AddMemoryAccess(address, value, read);
+                };
+            };
+            m_emulator.GetMemoryBus().RegisterCallbacks(OnAccess(true), OnAccess(false));
+        }
+
+        ~InstructionHasher() { m_emulator.GetMemoryBus().RegisterCallbacks({}, {}); }
+
+        InstructionHasher(const InstructionHasher&) = delete;
+        InstructionHasher& operator=(const InstructionHasher&) = delete;
+
+        cycles_t ExecuteInstruction(const Input& input, RenderContext& renderContext,
+                                    AudioContext& audioContext) {
+            Trace::InstructionTraceInfo traceInfo;
+            m_currTraceInfo = &traceInfo;
+            Trace::PreOpWriteTraceInfo(traceInfo, m_emulator.GetCpu().Registers(),
+                                       m_emulator.GetMemoryBus());
+
+            const cycles_t cycles =
+                m_emulator.ExecuteInstruction(input, renderContext, audioContext);
+            m_currTraceInfo = nullptr;
+
+            // If the CPU didn't do anything (e.g. waiting for interrupts), there's nothing to hash
+            const auto& registers = m_emulator.GetCpu().Registers();
+            if (m_lastPC && *m_lastPC == registers.PC)
+                return cycles;
+
+            Trace::PostOpWriteTraceInfo(traceInfo, registers, cycles);
+            m_hash = Trace::HashTraceInfo(traceInfo, m_hash);
+            m_lastPC = registers.PC;
+            return cycles;
+        }
+
+        uint32_t Hash() const { return m_hash; }
+
+    private:
+        Emulator& m_emulator;
+        Trace::InstructionTraceInfo* m_currTraceInfo = nullptr;
+        std::optional<uint16_t> m_lastPC; // After the last hashed instruction
+        uint32_t m_hash = 0;
+    };
+
+    // Draws frames with SoftRender, or SoftCrtRender with -crt
+    class FrameRender {
+    public:
+        bool Init(const Options& options) {
+            if (!options.renderCrt) {
+                m_render.Init(options.renderWidth, options.renderHeight, options.renderThreads);
+                m_render.SetSimd(options.renderSimd);
+                return true;
+            }
+
+            m_crtRender.emplace();
+            m_crtRender->Init(options.renderWidth, options.renderHeight, options.renderThreads);
+            m_crtRender->SetSimd(options.renderSimd);
+            if (!options.overlayFile.empty() &&
+                !m_crtRender->LoadOverlay(options.overlayFile.c_str())) {
+                fprintf(stderr, "Failed to load overlay: %s\n", options.overlayFile.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void Render(double frameTime, const LineBuffer& lines) {
+            if (m_crtRender) {
+                m_crtRender->Render(frameTime, lines);
+            } else {
+                m_render.Clear();
+                m_render.DrawLines(lines);
+            }
+        }
+
+        bool SaveScreenshot(const char* file) const {
+            const int numChannels = m_crtRender ? 3 : 1;
+            std::vector<uint8_t> image(static_cast<size_t>(Width()) * Height() * numChannels);
+            if (m_crtRender)
+                m_crtRender->ToRgb8(image.data());
+            else
+                m_render.ToGray8(image.data());
+            return ImageUtil::savePngImage(file, Width(), Height(), numChannels, image.data());
+        }
+
+        int Width() const { return m_crtRender ? m_crtRender->Width() : m_render.Width(); }
+        int Height() const { return m_crtRender ? m_crtRender->Height() : m_render.Height(); }
+        int NumThreads() const {
+            return m_crtRender ? m_crtRender->NumThreads() : m_render.NumThreads();
+        }
+        SoftRender::Simd GetSimd() const {
+            return m_crtRender ? m_crtRender->GetSimd() : m_render.GetSimd();
+        }
+
+        const SoftCrtRender* CrtRender() const { return m_crtRender ? &*m_crtRender : nullptr; }
+
+    private:
+        SoftRender m_render;
+        std::optional<SoftCrtRender> m_crtRender;
+    };
+
+    // Builds the vertices GLRender draws a frame's lines with by default, as thick base lines and
+    // thicker glow lines, for a CRT texture of the render size. Returns the number of vertices.
+    size_t BuildVertices(LineVertices& vertices, const Options& options, const LineBuffer& lines) {
+        const int width = options.renderWidth > 0 ? options.renderWidth : DefaultRenderWidth;
+        const int height = options.renderHeight > 0 ? options.renderHeight : DefaultRenderHeight;
+        const float scaleX = width / 256.f;
+        const float scaleY = height / 256.f;
+
+        vertices.BuildQuads(lines, SoftRender::LineWidthNormal * scaleX, scaleX, scaleY);
+        size_t numVertices = vertices.Quads().size;
+        vertices.BuildQuads(lines, SoftCrtRender::LineWidthGlow * scaleX, scaleX, scaleY);
+        numVertices += vertices.Quads().size;
+        return numVertices;
+    }
+
+    // If render is set, each frame's lines are drawn to it. If vertices is set, GLRender's vertices
+    // are built with it.
+    RunStats Run(Emulator& emulator, const Options& options, Movie& movie, FrameRender* render,
+                 LineVertices* vertices) {
+        const bool playing = !options.playFile.empty();
+        const bool recording = !options.recordFile.empty();
+
+        const cycles_t totalCycles =
+            options.cycles > 0 ? options.cycles
+                               : static_cast<cycles_t>(options.frames * CyclesPerFrame);
+
+        Input input;
+        RenderContext renderContext;
+        AudioContext audioContext{static_cast<float>(Cpu::Hz / AudioSampleRate)};
+        RunStats stats;
+
+        if (options.lineArrays)
+            renderContext.lines.SetLayout(LineBuffer::Layout::Arrays);
+        emulator.SetOutputEnabled(options.output);
+
+        std::optional<InstructionHasher> hasher;
+        if (options.hash)
+            hasher.emplace(emulator);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        uint64_t numFrames = options.cycles > 0
+                                 ? static_cast<uint64_t>(ceil(totalCycles / CyclesPerFrame))
+                                 : options.frames;
+        if (playing)
+            numFrames = movie.NumFrames();
+
+        cycles_t targetCycles = 0;
+        double movieCyclesLeft = 0;
+        for (uint64_t frame = 0; frame < numFrames; ++frame) {
+            // Movies are run the same way Debugger::ExecuteFrameInstructions does, so that replays
+            // of movies recorded in the engine match
+            cycles_t frameCycles = 0;
+            if (playing || recording) {
+                double frameTime = 1.0 / FramesPerSecond;
+                if (playing)
+                    movie.PlayFrame(frameTime, input);
+                else
+                    movie.RecordFrame(frameTime, input);
+
+                movieCyclesLeft += Cpu::Hz * frameTime;
+                if (movieCyclesLeft > 0)
+                    frameCycles = static_cast<cycles_t>(std::ceil(movieCyclesLeft));
+            } else {
+                targetCycles =
+                    std::min(static_cast<cycles_t>((frame + 1) * CyclesPerFrame), totalCycles);
+                frameCycles = targetCycles > stats.cycles ? targetCycles - stats.cycles : 0;
+            }
+
+            cycles_t elapsedCycles = 0;
+            if (!options.step && frameCycles > 0) {
+                const auto result =
+                    emulator.RunCycles(frameCycles, input, renderContext, audioContext);
+                elapsedCycles += result.cycles;
+                stats.instructions += result.instructions;
+            }
+
+            while (options.step && elapsedCycles < frameCycles) {
+                cycles_t elapsed = 0;
+                if (options.skipIdle) {
+                    elapsed = emulator.SkipIdleCycles(frameCycles - elapsedCycles, input,
+                                                      renderContext, audioContext);
+                }
+                if (elapsed == 0) {
+                    elapsed = hasher ? hasher->ExecuteInstruction(input, renderContext,
+                                                                  audioContext)
+                                     : emulator.ExecuteInstruction(input, renderContext,
+                                                                   audioContext);
+                    ++stats.instructions;
+                }
+                elapsedCycles += elapsed;
+            }
+
+            stats.cycles += elapsedCycles;
+            movieCyclesLeft -= elapsedCycles;
+
+            emulator.FrameUpdate(1.0 / FramesPerSecond);
+            ++stats.frames;
+
+            // The engine would consume these here
+            if (render) {
+                const auto renderStart = std::chrono::steady_clock::now();
+                render->Render(1.0 / FramesPerSecond, renderContext.lines);
+                const auto renderEnd = std::chrono::steady_clock::now();
+                stats.renderSeconds +=
+                    std::chrono::duration<double>(renderEnd - renderStart).count();
+            }
+            if (vertices) {
+                const auto vertexStart = std::chrono::steady_clock::now();
+                stats.vertices += BuildVertices(*vertices, options, renderContext.lines);
+                const auto vertexEnd = std::chrono::steady_clock::now();
+                stats.vertexSeconds +=
+                    std::chrono::duration<double>(vertexEnd - vertexStart).count();
+            }
+            stats.lines += renderContext.lines.Size();
+            stats.audioSamples += audioContext.samples.size();
+            renderContext.lines.Clear();
+            audioContext.samples.clear();
+        }
+
+        stats.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto& lineStats = emulator.GetVia().GetScreen().GetLineStats();
+        stats.coalescedLines = lineStats.coalescedLines;
+        stats.dedupedDots = lineStats.dedupedDots;
+        if (hasher)
+            stats.instructionHash = hasher->Hash();
+        return stats;
+    }
+
+    constexpr Profiler::Section ReportedSections[] = {
+        Profiler::Section::Cpu,    Profiler::Section::Via,           Profiler::Section::Psg,
+        Profiler::Section::Screen, Profiler::Section::RenderContext, Profiler::Section::Other,
+    };
+
+    void PrintText(const Options& options, const RunStats& stats, const RunStats* profileStats,
+                   const FrameRender* render, const LineVertices* vertices) {
+        const double emulatedSeconds = stats.cycles / Cpu::Hz;
+
+        printf("rom:                 %s\n",
+               options.romFile.empty() ? "(built-in)" : options.romFile.c_str());
+        printf("frames:              %llu\n", static_cast<unsigned long long>(stats.frames));
+        printf("cycles:              %llu\n", static_cast<unsigned long long>(stats.cycles));
+        printf("instructions:        %llu\n", static_cast<unsigned long long>(stats.instructions));
+        printf("lines:               %llu\n", static_cast<unsigned long long>(stats.lines));
+        printf("coalesced lines:     %llu\n",
+               static_cast<unsigned long long>(stats.coalescedLines));
+        printf("deduped dots:        %llu\n", static_cast<unsigned long long>(stats.dedupedDots));
+        printf("audio samples:       %llu\n", static_cast<unsigned long long>(stats.audioSamples));
+        printf("wall time:           %.3f s\n", stats.seconds);
+        printf("instructions/sec:    %.0f\n", stats.instructions / stats.seconds);
+        printf("cycles/sec:          %.0f\n", stats.cycles / stats.seconds);
+        printf("frames/sec:          %.1f\n", stats.frames / stats.seconds);
+        printf("speed vs real time:  %.2fx\n", emulatedSeconds / stats.seconds);
+        if (options.hash)
+            printf("instruction hash:    $%08x\n", stats.instructionHash);
+        if (render) {
+            printf("render:              %dx%d, %d threads, %s\n", render->Width(),
+                   render->Height(), render->NumThreads(), SoftRender::SimdName(render->GetSimd()));
+            printf("render time:         %.3f s\n", stats.renderSeconds);
+            printf("rendered frames/sec: %.1f\n", stats.frames / stats.renderSeconds);
+            if (auto crtRender = render->CrtRender()) {
+                for (int i = 0; i < static_cast<int>(SoftCrtRender::Stage::Count); ++i) {
+                    const auto stage = static_cast<SoftCrtRender::Stage>(i);
+                    printf("  %-17s %8.3f s\n", SoftCrtRender::StageName(stage),
+                           crtRender->StageSeconds(stage));
+                }
+            }
+        }
+        if (vertices) {
+            printf("vertices:            %llu, %s\n",
+                   static_cast<unsigned long long>(stats.vertices),
+                   SoftRender::SimdName(vertices->GetSimd()));
+            printf("vertex time:         %.3f s\n", stats.vertexSeconds);
+            printf("vertices/sec:        %.0f\n", stats.vertices / stats.vertexSeconds);
+        }
+
+        if (profileStats) {
+            printf("\nsubsystem time (profiled run, %.3f s):\n", profileStats->seconds);
+            for (auto section : ReportedSections) {
+                const double seconds = Profiler::Seconds(section);
+                printf("  %-15s %8.3f s  %5.1f%%\n", Profiler::SectionName(section), seconds,
+                       100.0 * seconds / profileStats->seconds);
+            }
+        }
+    }
+
+    void PrintJson(const Options& options, const RunStats& stats, const RunStats* profileStats,
+                   const FrameRender* render, const LineVertices* vertices) {
+        const double emulatedSeconds = stats.cycles / Cpu::Hz;
+
+        printf("{\n");
+        printf("  \"rom\": \"%s\",\n", options.romFile.c_str());
+        printf("  \"frames\": %llu,\n", static_cast<unsigned long long>(stats.frames));
+        printf("  \"cycles\": %llu,\n", static_cast<unsigned long long>(stats.cycles));
+        printf("  \"instructions\": %llu,\n", static_cast<unsigned long long>(stats.instructions));
+        printf("  \"lines\": %llu,\n", static_cast<unsigned long long>(stats.lines));
+        printf("  \"coalescedLines\": %llu,\n",
+               static_cast<unsigned long long>(stats.coalescedLines));
+        printf("  \"dedupedDots\": %llu,\n", static_cast<unsigned long long>(stats.dedupedDots));
+        printf("  \"audioSamples\": %llu,\n",
+               static_cast<unsigned long long>(stats.audioSamples));
+        printf("  \"wallSeconds\": %.6f,\n", stats.seconds);
+        printf("  \"instructionsPerSecond\": %.0f,\n", stats.instructions / stats.seconds);
+        printf("  \"cyclesPerSecond\": %.0f,\n", stats.cycles / stats.seconds);
+        printf("  \"framesPerSecond\": %.3f,\n", stats.frames / stats.seconds);
+        printf("  \"realTimeSpeed\": %.4f", emulatedSeconds / stats.seconds);
+        if (options.hash)
+            printf(",\n  \"instructionHash\": \"%08x\"", stats.instructionHash);
+        if (render) {
+            printf(",\n  \"render\": {\n");
+            printf("    \"width\": %d,\n", render->Width());
+            printf("    \"height\": %d,\n", render->Height());
+            printf("    \"threads\": %d,\n", render->NumThreads());
+            printf("    \"simd\": \"%s\",\n", SoftRender::SimdName(render->GetSimd()));
+            printf("    \"seconds\": %.6f,\n", stats.renderSeconds);
+            printf("    \"framesPerSecond\": %.3f", stats.frames / stats.renderSeconds);
+            if (auto crtRender = render->CrtRender()) {
+                printf(",\n    \"stageSeconds\": {");
+                for (int i = 0; i < static_cast<int>(SoftCrtRender::Stage::Count); ++i) {
+                    const auto stage = static_cast<SoftCrtRender::Stage>(i);
+                    printf("%s\n      \"%s\": %.6f", i > 0 ? "," : "",
+                           SoftCrtRender::StageName(stage), crtRender->StageSeconds(stage));
+                }
+                printf("\n    }");
+            }
+            printf("\n  }");
+        }
+        if (vertices) {
+            printf(",\n  \"vertices\": {\n");
+            printf("    \"simd\": \"%s\",\n", SoftRender::SimdName(vertices->GetSimd()));
+            printf("    \"count\": %llu,\n", static_cast<unsigned long long>(stats.vertices));
+            printf("    \"seconds\": %.6f,\n", stats.vertexSeconds);
+            printf("    \"verticesPerSecond\": %.0f", stats.vertices / stats.vertexSeconds);
+            printf("\n  }");
+        }
+
+        if (profileStats) {
+            printf(",\n  \"profile\": {\n");
+            printf("    \"wallSeconds\": %.6f", profileStats->seconds);
+            for (auto section : ReportedSections) {
+                printf(",\n    \"%s\": %.6f", Profiler::SectionName(section),
+                       Profiler::Seconds(section));
+            }
+            printf("\n  }");
+        }
+        printf("\n}\n");
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    Movie movie;
+    if (!options.playFile.empty() && !movie.Load(options.playFile.c_str())) {
+        fprintf(stderr, "Failed to load movie: %s\n", options.playFile.c_str());
+        return 1;
+    }
+
+    FrameRender frameRender;
+    FrameRender* render = nullptr;
+    if (options.renderWidth > 0) {
+        if (!frameRender.Init(options))
+            return 1;
+        render = &frameRender;
+    }
+
+    LineVertices lineVertices;
+    LineVertices* vertices = nullptr;
+    if (options.vertices) {
+        lineVertices.SetSimd(options.renderSimd);
+        vertices = &lineVertices;
+    }
+
+    Emulator emulator;
+    if (!ResetEmulator(emulator, options, movie))
+        return 1;
+    const RunStats stats = Run(emulator, options, movie, render, vertices);
+
+    if (!options.screenshotFile.empty()) {
+        if (!render->SaveScreenshot(options.screenshotFile.c_str())) {
+            fprintf(stderr, "Failed to save screenshot: %s\n", options.screenshotFile.c_str());
+            return 1;
+        }
+    }
+
+    if (!options.recordFile.empty()) {
+        movie.GetHeader().instructionHash = stats.instructionHash;
+        if (!movie.Save(options.recordFile.c_str())) {
+            fprintf(stderr, "Failed to save movie: %s\n", options.recordFile.c_str());
+            return 1;
+        }
+    }
+
+    RunStats profileStats;
+    if (options.profile) {
+        Emulator profileEmulator;
+        if (!ResetEmulator(profileEmulator, options, movie))
+            return 1;
+
+        Profiler::Start();
+        // Without rendering, so that render times, including the CRT's per stage, are those of
+        // the first run
+        profileStats = Run(profileEmulator, options, movie, nullptr, nullptr);
+        Profiler::Stop();
+    }
+
+    if (options.json) {
+        PrintJson(options, stats, options.profile ? &profileStats : nullptr, render, vertices);
+    } else {
+        PrintText(options, stats, options.profile ? &profileStats : nullptr, render, vertices);
+    }
+
+    // Replays must reproduce the recording exactly
+    const uint32_t expectedHash = movie.GetHeader().instructionHash;
+    if (!options.playFile.empty() && options.hash && expectedHash != 0 &&
+        expectedHash != stats.instructionHash) {
+        fprintf(stderr, "Instruction hash mismatch: movie has $%08x\n", expectedHash);
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,769 @@
+#include "core/BitOps.h"
+#include "core/ErrorHandler.h"
+#include "core/FrameTimer.h"
+#include "core/LineBuffer.h"
+#include "core/SpscRingBuffer.h"
+#include "core/TripleBuffer.h"
+#include "emulator/Cpu.h"
+#include "emulator/CpuHelpers.h"
+#include "emulator/CpuOpCodes.h"
+#include "emulator/EngineTypes.h"
+#include "emulator/MemoryBus.h"
+#include "emulator/Movie.h"
+#include "emulator/RewindBuffer.h"
+#include "emulator/SaveState.h"
+#include "emulator/Screen.h"
+#include "soft_render/LineVertices.h"
+#include "soft_render/SoftCrtRender.h"
+#include "soft_render/SoftRender.h"
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <vector>
+
+#undef FAIL
+#include "gtest/gtest.h"
+
+namespace {
+    // 64K of RAM so that the CPU can be run on arbitrary code and data
+    class TestMemory : public IMemoryBusDevice {
+    public:
+        void Init(MemoryBus& memoryBus) {
+            memoryBus.ConnectDevice(*this, {0x0000, 0xFFFF}, EnableSync::False);
+        }
+
+        uint8_t Read(uint16_t address) const override { return m_data[address]; }
+        void Write(uint16_t address, uint8_t value) override { m_data[address] = value; }
+
+        std::array<uint8_t, 0x10000> m_data{};
+    };
+
+    struct IndexedResult {
+        uint16_t EA{};
+        uint16_t X{}, Y{}, U{}, S{}, PC{};
+        cycles_t cycles{};
+    };
+
+    // Reference implementation of indexed addressing, decoding the postbyte with switches
+    IndexedResult ReferenceIndexedEA(const CpuRegisters& regs, const TestMemory& memory) {
+        IndexedResult r{0, regs.X, regs.Y, regs.U, regs.S, regs.PC, 0};
+
+        auto ReadPC8 = [&] { return memory.Read(r.PC++); };
+
+        auto RegisterSelect = [&](uint8_t postbyte) -> uint16_t& {
+            switch ((postbyte >> 5) & 0b11) {
+            case 0b00:
+                return r.X;
+            case 0b01:
+                return r.Y;
+            case 0b10:
+                return r.U;
+            default: // 0b11:
+                return r.S;
+            }
+        };
+
+        uint16_t EA = 0;
+        uint8_t postbyte = ReadPC8();
+        bool supportsIndirect = true;
+
+        if ((postbyte & BITS(7)) == 0) { // (+/- 4 bit offset),R
+            int8_t offset = postbyte & 0b0001'1111;
+            if (postbyte & BITS(4))
+                offset |= 0b1110'0000;
+            EA = RegisterSelect(postbyte) + offset;
+            supportsIndirect = false;
+            r.cycles += 1;
+        } else {
+            switch (postbyte & 0b1111) {
+            case 0b0000: { // ,R+
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg;
+                reg += 1;
+                supportsIndirect = false;
+                r.cycles += 2;
+            } break;
+            case 0b0001: { // ,R++
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg;
+                reg += 2;
+                r.cycles += 3;
+            } break;
+            case 0b0010: { // ,-R
+                auto& reg = RegisterSelect(postbyte);
+                reg -= 1;
+                EA = reg;
+                supportsIndirect = false;
+                r.cycles += 2;
+            } break;
+            case 0b0011: { // ,--R
+                auto& reg = RegisterSelect(postbyte);
+                reg -= 2;
+                EA = reg;
+                r.cycles += 3;
+            } break;
+            case 0b0100: // ,R
+                EA = RegisterSelect(postbyte);
+                break;
+            case 0b0101: // (+/- B),R
+                EA = RegisterSelect(postbyte) + S16(regs.B);
+                r.cycles += 1;
+                break;
+            case 0b0110: // (+/- A),R
+                EA = RegisterSelect(postbyte) + S16(regs.A);
+                r.cycles += 1;
+                break;
+            case 0b1000: { // (+/- 7 bit offset),R
+                uint8_t postbyte2 = ReadPC8();
+                EA = RegisterSelect(postbyte) + S16(postbyte2);
+                r.cycles += 1;
+            } break;
+            case 0b1001: { // (+/- 15 bit offset),R
+                uint8_t postbyte2 = ReadPC8();
+                uint8_t postbyte3 = ReadPC8();
+                EA = RegisterSelect(postbyte) + CombineToS16(postbyte2, postbyte3);
+                r.cycles += 4;
+            } break;
+            case 0b1011: // (+/- D),R
+                EA = RegisterSelect(postbyte) + S16(regs.D);
+                r.cycles += 4;
+                break;
+            case 0b1100: { // (+/- 7 bit offset),PC
+                uint8_t postbyte2 = ReadPC8();
+                EA = r.PC + S16(postbyte2);
+                r.cycles += 1;
+            } break;
+            case 0b1101: { // (+/- 15 bit offset),PC
+                uint8_t postbyte2 = ReadPC8();
+                uint8_t postbyte3 = ReadPC8();
+                EA = r.PC + CombineToS16(postbyte2, postbyte3);
+                r.cycles += 5;
+            } break;
+            case 0b1111: { // [address] (Indirect-only)
+                uint8_t postbyte2 = ReadPC8();
+                uint8_t postbyte3 = ReadPC8();
+                EA = CombineToS16(postbyte2, postbyte3);
+                r.cycles += 2;
+            } break;
+            default: // Illegal
+                break;
+            }
+        }
+
+        if (supportsIndirect && (postbyte & BITS(4))) {
+            uint8_t msb = memory.Read(EA);
+            uint8_t lsb = memory.Read(EA + 1);
+            EA = CombineToU16(msb, lsb);
+            r.cycles += 3;
+        }
+
+        r.EA = EA;
+        return r;
+    }
+} // namespace
+
+TEST(Cpu, IndexedAddressingAllPostbytes) {
+    // Illegal postbytes are reported, but we still want to compare the resulting state
+    ErrorHandler::SetPolicy(ErrorHandler::Policy::Ignore);
+
+    const uint16_t programAddress = 0x1000;
+    const uint8_t jmpIndexed = 0x6E;
+
+    for (int postbyte = 0; postbyte < 256; ++postbyte) {
+        MemoryBus memoryBus;
+        TestMemory memory;
+        memory.Init(memoryBus);
+
+        // Fill memory with a pattern so that offsets and indirect addresses vary
+        for (size_t i = 0; i < memory.m_data.size(); ++i) {
+            memory.m_data[i] = static_cast<uint8_t>(i * 7 + 3);
+        }
+
+        // Load distinct values in all registers, then JMP using the indexed postbyte, as it
+        // sets PC to the EA without modifying any other register.
+        const uint8_t program[] = {
+            0x8E, 0x20, 0x10,       // LDX #$2010
+            0x10, 0x8E, 0x30, 0x20, // LDY #$3020
+            0xCE, 0x40, 0x30,       // LDU #$4030
+            0x10, 0xCE, 0x50, 0x40, // LDS #$5040
+            0xCC, 0x81, 0x7F,       // LDD #$817F
+            jmpIndexed, static_cast<uint8_t>(postbyte),
+        };
+        std::copy(std::begin(program), std::end(program), memory.m_data.begin() + programAddress);
+        memory.m_data[0xFFFE] = programAddress >> 8;
+        memory.m_data[0xFFFF] = programAddress & 0xFF;
+
+        Cpu cpu;
+        cpu.Init(memoryBus);
+        cpu.Reset();
+        for (int i = 0; i < 5; ++i) {
+            cpu.ExecuteInstruction(false, false);
+        }
+
+        // Skip the JMP opcode, as the reference starts at the postbyte
+        CpuRegisters preOpRegs = cpu.Registers();
+        ++preOpRegs.PC;
+        const IndexedResult expected = ReferenceIndexedEA(preOpRegs, memory);
+
+        const cycles_t cycles = cpu.ExecuteInstruction(false, false);
+        const auto& regs = cpu.Registers();
+
+        SCOPED_TRACE(testing::Message() << "postbyte: " << postbyte);
+        EXPECT_EQ(regs.PC, expected.EA);
+        EXPECT_EQ(regs.X, expected.X);
+        EXPECT_EQ(regs.Y, expected.Y);
+        EXPECT_EQ(regs.U, expected.U);
+        EXPECT_EQ(regs.S, expected.S);
+        EXPECT_EQ(regs.D, 0x817F);
+        EXPECT_EQ(cycles, LookupCpuOp(0, jmpIndexed).cycles + expected.cycles);
+    }
+
+    ErrorHandler::SetPolicy(ErrorHandler::DefaultPolicy);
+}
+
+TEST(Cpu, SaveStateRoundTrip) {
+    MemoryBus memoryBus;
+    TestMemory memory;
+    memory.Init(memoryBus);
+
+    // Loop that updates registers and flags: ADDA #$35, LEAX 1,X, BRA -6
+    const uint16_t programAddress = 0x1000;
+    const uint8_t program[] = {0x8B, 0x35, 0x30, 0x01, 0x20, 0xFA};
+    std::copy(std::begin(program), std::end(program), memory.m_data.begin() + programAddress);
+    memory.m_data[0xFFFE] = programAddress >> 8;
+    memory.m_data[0xFFFF] = programAddress & 0xFF;
+
+    Cpu cpu;
+    cpu.Init(memoryBus);
+    cpu.Reset();
+    for (int i = 0; i < 10; ++i) {
+        cpu.ExecuteInstruction(false, false);
+    }
+
+    std::array<uint8_t, 256> state{};
+    StateWriter writer{state.data(), state.size()};
+    cpu.Serialize(writer);
+
+    auto RunAndGetRegisters = [&] {
+        for (int i = 0; i < 25; ++i) {
+            cpu.ExecuteInstruction(false, false);
+        }
+        return cpu.Registers();
+    };
+
+    const CpuRegisters expected = RunAndGetRegisters();
+
+    StateReader reader{state.data(), state.size()};
+    cpu.Serialize(reader);
+    EXPECT_EQ(reader.Offset(), writer.Offset());
+
+    const CpuRegisters actual = RunAndGetRegisters();
+    EXPECT_EQ(actual.PC, expected.PC);
+    EXPECT_EQ(actual.D, expected.D);
+    EXPECT_EQ(actual.X, expected.X);
+    EXPECT_EQ(actual.CC.Value, expected.CC.Value);
+}
+
+TEST(RewindBuffer, PeekAndRewind) {
+    const size_t stateSize = 1000;
+    const size_t maxFrames = 1000;
+
+    // Small enough that the oldest frames get discarded
+    RewindBuffer rewindBuffer;
+    rewindBuffer.Init(stateSize, 100 * 1024, maxFrames, 10);
+
+    // States with a few bytes changing per frame, like the emulator's
+    std::vector<std::vector<uint8_t>> states;
+    std::vector<uint8_t> state(stateSize);
+    auto PushFrames = [&](size_t numFrames) {
+        for (size_t i = 0; i < numFrames; ++i) {
+            const size_t frame = states.size();
+            for (size_t j = 0; j < 8; ++j) {
+                state[(frame * 31 + j * 97) % stateSize] ^= static_cast<uint8_t>(frame + j + 1);
+            }
+            states.push_back(state);
+            rewindBuffer.Push(state.data());
+        }
+    };
+
+    PushFrames(2000);
+    ASSERT_GT(rewindBuffer.NumFrames(), 10u);
+    ASSERT_LT(rewindBuffer.NumFrames(), states.size());
+
+    std::vector<uint8_t> result(stateSize);
+    for (size_t framesBack = 0; framesBack < rewindBuffer.NumFrames(); ++framesBack) {
+        ASSERT_TRUE(rewindBuffer.Peek(framesBack, result.data()));
+        EXPECT_EQ(result, states[states.size() - 1 - framesBack]) << "framesBack: " << framesBack;
+    }
+    EXPECT_FALSE(rewindBuffer.Peek(rewindBuffer.NumFrames(), result.data()));
+
+    // Rewinding discards the more recent frames, and pushing continues from the rewound state
+    const size_t numFrames = rewindBuffer.NumFrames();
+    ASSERT_TRUE(rewindBuffer.Rewind(5, result.data()));
+    EXPECT_EQ(rewindBuffer.NumFrames(), numFrames - 5);
+    states.resize(states.size() - 5);
+    EXPECT_EQ(result, states.back());
+
+    state = result;
+    PushFrames(3);
+    for (size_t framesBack = 0; framesBack < 10; ++framesBack) {
+        ASSERT_TRUE(rewindBuffer.Peek(framesBack, result.data()));
+        EXPECT_EQ(result, states[states.size() - 1 - framesBack]) << "framesBack: " << framesBack;
+    }
+}
+
+TEST(MemoryBus, DirtyRanges) {
+    MemoryBus memoryBus;
+    TestMemory memory;
+    memory.Init(memoryBus);
+
+    using Ranges = std::vector<MemoryRange>;
+    auto CollectDirtyRanges = [&] {
+        Ranges ranges;
+        memoryBus.CollectDirtyRanges([&](MemoryRange range) { ranges.push_back(range); });
+        return ranges;
+    };
+
+    // Not tracked while disabled
+    memoryBus.Write(0x0000, 1);
+    memoryBus.SetDirtyTrackingEnabled(true);
+    EXPECT_EQ(CollectDirtyRanges(), Ranges{});
+
+    memoryBus.Write(0x0010, 1);
+    memoryBus.Write(0x0025, 1); // Adjacent block, merged with previous
+    memoryBus.Write(0x1000, 1);
+    memoryBus.Write(0x107F, 1);
+    memoryBus.Write(0xFFFF, 1);
+    const Ranges expected = {
+        {0x0000, 0x003F}, {0x1000, 0x101F}, {0x1060, 0x107F}, {0xFFE0, 0xFFFF}};
+    EXPECT_EQ(CollectDirtyRanges(), expected);
+
+    // Collecting clears
+    EXPECT_EQ(CollectDirtyRanges(), Ranges{});
+
+    memoryBus.MarkAllDirty();
+    EXPECT_EQ(CollectDirtyRanges(), (Ranges{{0x0000, 0xFFFF}}));
+}
+
+TEST(Movie, RecordSaveLoadPlay) {
+    // Inputs held for a while, like a player's, with a frame time that varies now and then
+    std::vector<std::pair<double, Input>> frames;
+    Input input;
+    for (int i = 0; i < 500; ++i) {
+        if (i % 50 == 0)
+            input.SetButton(static_cast<uint8_t>(i / 50 % 2), static_cast<uint8_t>(i / 100 % 4),
+                            i % 100 == 0);
+        if (i % 70 == 0)
+            input.SetAnalogAxisX(i / 70 % 2, static_cast<int8_t>(i - 250));
+        if (i % 90 == 0)
+            input.SetAnalogAxisY(i / 90 % 2, static_cast<int8_t>(-i));
+        frames.push_back({i % 120 == 0 ? 1.0 / 30 : 1.0 / 60, input});
+    }
+
+    Movie movie;
+    movie.BeginRecording({1234, 0xB105, 0x7011, 0xC0FFEE});
+    for (auto& [frameTime, frameInput] : frames) {
+        movie.RecordFrame(frameTime, frameInput);
+    }
+
+    const auto file = fs::temp_directory_path() / "vectrexy_movie_test.vxm";
+    ASSERT_TRUE(movie.Save(file.string().c_str()));
+    // Runs of identical values must be stored once
+    EXPECT_LT(fs::file_size(file), 500u);
+
+    Movie loaded;
+    ASSERT_TRUE(loaded.Load(file.string().c_str()));
+    fs::remove(file);
+
+    EXPECT_EQ(loaded.GetHeader().ramSeed, 1234u);
+    EXPECT_EQ(loaded.GetHeader().biosHash, 0xB105u);
+    EXPECT_EQ(loaded.GetHeader().romHash, 0x7011u);
+    EXPECT_EQ(loaded.GetHeader().instructionHash, 0xC0FFEEu);
+    ASSERT_EQ(loaded.NumFrames(), frames.size());
+
+    // Played twice, as playback is restarted on reset
+    for (int pass = 0; pass < 2; ++pass) {
+        loaded.BeginPlayback();
+        for (size_t i = 0; i < frames.size(); ++i) {
+            double frameTime{};
+            Input frameInput;
+            ASSERT_TRUE(loaded.PlayFrame(frameTime, frameInput));
+            EXPECT_EQ(frameTime, frames[i].first) << "frame: " << i;
+            EXPECT_EQ(frameInput.ButtonStateMask(), frames[i].second.ButtonStateMask());
+            for (int axis = 0; axis < 4; ++axis) {
+                EXPECT_EQ(frameInput.AnalogStateMask(axis), frames[i].second.AnalogStateMask(axis));
+            }
+        }
+        double frameTime{};
+        EXPECT_FALSE(loaded.PlayFrame(frameTime, input));
+    }
+}
+
+TEST(TripleBuffer, LatestValueHandoff) {
+    // Each value is a buffer full of the same number, so torn reads would show up
+    using Value = std::array<int, 64>;
+    constexpr int NumValues = 100000;
+
+    TripleBuffer<Value> buffer;
+    std::thread writer([&] {
+        for (int i = 1; i <= NumValues; ++i) {
+            buffer.WriteBuffer().fill(i);
+            buffer.Publish();
+        }
+    });
+
+    int last = 0;
+    while (last != NumValues) {
+        if (!buffer.Consume()) {
+            std::this_thread::yield();
+            continue;
+        }
+        const Value& value = buffer.ReadBuffer();
+        ASSERT_TRUE(std::all_of(value.begin(), value.end(), [&](int v) { return v == value[0]; }));
+        // Values may be skipped, but never seen out of order
+        ASSERT_GT(value[0], last);
+        last = value[0];
+    }
+    writer.join();
+
+    EXPECT_TRUE(buffer.Consumed());
+    EXPECT_FALSE(buffer.Consume());
+    EXPECT_EQ(buffer.ReadBuffer()[0], NumValues);
+}
+
+TEST(SpscRingBuffer, PushPopAcrossThreads) {
+    constexpr int NumValues = 100000;
+
+    SpscRingBuffer<int> ring(1000);
+    EXPECT_EQ(ring.TotalSize(), 1000u);
+
+    std::thread producer([&] {
+        std::array<int, 37> values{};
+        int next = 0;
+        while (next < NumValues) {
+            const int count = std::min(static_cast<int>(values.size()), NumValues - next);
+            for (int i = 0; i < count; ++i)
+                values[i] = next + i;
+            const int pushed = static_cast<int>(ring.Push(values.data(), count));
+            if (pushed == 0)
+                std::this_thread::yield();
+            next += pushed;
+        }
+    });
+
+    // Values must come out in order, none lost or repeated
+    std::array<int, 53> values{};
+    int expected = 0;
+    while (expected < NumValues) {
+        const size_t count = ring.Pop(values.data(), values.size());
+        if (count == 0)
+            std::this_thread::yield();
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(values[i], expected++);
+        }
+    }
+    producer.join();
+
+    EXPECT_EQ(ring.UsedSize(), 0u);
+    EXPECT_EQ(ring.Pop(values.data(), values.size()), 0u);
+
+    // Pushes that don't fit are truncated
+    std::vector<int> many(1500, 7);
+    EXPECT_EQ(ring.Push(many.data(), many.size()), 1000u);
+    EXPECT_EQ(ring.UsedSize(), 1000u);
+}
+
+TEST(LineBuffer, LayoutsAndMaxLines) {
+    for (auto layout : {LineBuffer::Layout::Lines, LineBuffer::Layout::Arrays}) {
+        LineBuffer lines;
+        lines.SetLayout(layout);
+        lines.PushBack({{0, 0}, {1, 1}, 0.5f});
+        lines.PushBack({{1, 1}, {2, 2}, 1.f});
+        lines.SetBackEnd({3, 4});
+        ASSERT_EQ(lines.Size(), 2u);
+        EXPECT_EQ(lines.Get(0).brightness, 0.5f);
+        EXPECT_EQ(lines.Back().p1.x, 3.f);
+        EXPECT_EQ(lines.Back().p1.y, 4.f);
+
+        lines.Set(0, {{5, 5}, {6, 6}, 0.25f});
+        lines.PopBack();
+        ASSERT_EQ(lines.Size(), 1u);
+        EXPECT_EQ(lines.Back().p0.x, 5.f);
+
+        // Lines are kept when switching layouts
+        const auto other = layout == LineBuffer::Layout::Lines ? LineBuffer::Layout::Arrays
+                                                                : LineBuffer::Layout::Lines;
+        lines.SetLayout(other);
+        ASSERT_EQ(lines.Size(), 1u);
+        EXPECT_EQ(lines.Get(0).p1.y, 6.f);
+        EXPECT_EQ(lines.Get(0).brightness, 0.25f);
+        lines.SetLayout(layout);
+
+        // Storage survives Clear
+        lines.Reserve(100);
+        const size_t capacity = lines.Capacity();
+        lines.Clear();
+        EXPECT_TRUE(lines.Empty());
+        EXPECT_EQ(lines.Capacity(), capacity);
+
+        // Lines past the max are dropped, and so are all the following ones until Clear
+        lines.SetMaxLines(2);
+        for (int i = 0; i < 5; ++i)
+            lines.PushBack({{static_cast<float>(i), 0}, {static_cast<float>(i), 1}, 1.f});
+        EXPECT_EQ(lines.Size(), 2u);
+        EXPECT_EQ(lines.NumDropped(), 3u);
+        lines.SetBackEnd({10, 10});
+        EXPECT_EQ(lines.Back().p1.x, 1.f);
+
+        int count = 0;
+        lines.ForEach([&](const Line& line) { EXPECT_EQ(line.p0.x, static_cast<float>(count++)); });
+        EXPECT_EQ(count, 2);
+
+        lines.Clear();
+        EXPECT_EQ(lines.NumDropped(), 0u);
+        lines.PushBack({{0, 0}, {1, 1}, 1.f});
+        EXPECT_EQ(lines.Size(), 1u);
+    }
+}
+
+TEST(FrameTimeStats, Percentiles) {
+    FrameTimeStats stats(100);
+    EXPECT_EQ(stats.Percentile(50), 0);
+
+    // Older frames than the last 100 are forgotten
+    for (int i = 0; i < 50; ++i)
+        stats.AddFrameTime(1000);
+    for (int i = 100; i >= 1; --i)
+        stats.AddFrameTime(i);
+
+    EXPECT_EQ(stats.NumFrames(), 100u);
+    EXPECT_EQ(stats.Percentile(0), 1);
+    EXPECT_EQ(stats.Percentile(50), 51);
+    EXPECT_EQ(stats.Percentile(99), 99);
+    EXPECT_EQ(stats.Percentile(100), 100);
+}
+
+TEST(FramePacer, WaitsForFrameDuration) {
+    using Clock = FramePacer::Clock;
+    constexpr double FrameDuration = 0.005;
+
+    FramePacer pacer;
+    pacer.WaitForNextFrame(FrameDuration); // Starts pacing
+    const auto start = Clock::now();
+    for (int i = 0; i < 10; ++i)
+        pacer.WaitForNextFrame(FrameDuration);
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    // Frames are due at fixed intervals from the first one, so it can't be faster
+    EXPECT_GE(elapsed.count(), 10 * FrameDuration - 0.001);
+}
+
+TEST(Screen, CoalesceLinesAndDedupDots) {
+    Screen screen;
+    screen.Init();
+    RenderContext renderContext;
+    screen.SetBrightness(100);
+
+    // The X offset cancels out Y velocity, so lines are horizontal whatever the X velocity
+    screen.SetIntegratorXYOffset(5);
+    screen.SetIntegratorY(-5);
+    screen.SetIntegratorX(10);
+    screen.SetIntegratorsEnabled(true);
+    screen.Update(100, renderContext);
+    screen.SetIntegratorX(20);
+    screen.Update(100, renderContext);
+    screen.SetIntegratorX(30);
+    screen.Update(100, renderContext);
+
+    // Dots while the beam is stopped
+    screen.SetIntegratorsEnabled(false);
+    screen.SetIntegratorXYOffset(0);
+    screen.SetIntegratorX(0);
+    screen.SetIntegratorY(0);
+    screen.Update(100, renderContext);
+
+    // A line in another direction, so that the dots can be merged
+    screen.SetIntegratorY(10);
+    screen.SetIntegratorsEnabled(true);
+    screen.Update(100, renderContext);
+
+    ASSERT_EQ(renderContext.lines.Size(), 3u);
+    const Line line = renderContext.lines.Get(0);
+    EXPECT_EQ(line.p0.y, line.p1.y);
+    EXPECT_GT(line.p1.x, line.p0.x);
+    EXPECT_EQ(renderContext.lines.Get(1).p0, renderContext.lines.Get(1).p1);
+    EXPECT_GE(screen.GetLineStats().coalescedLines, 2u);
+    EXPECT_GT(screen.GetLineStats().dedupedDots, 0u);
+}
+
+TEST(SoftRender, DrawLinesAndDots) {
+    // Odd width so that SIMD rows end with a partial group of pixels
+    constexpr int Width = 203;
+    constexpr int Height = 256;
+
+    const LineBuffer lines = {
+        {{-100, -100}, {100, 60}, 1.f},   // Diagonal
+        {{-128, 100}, {128, 100}, 0.5f},  // Horizontal, across the whole width
+        {{50, -50}, {50, -50}, 1.f},      // Dot
+        {{300, 300}, {400, 400}, 1.f},    // Off screen
+    };
+
+    std::vector<float> scalarPixels;
+    for (auto simd : {SoftRender::Simd::Scalar, SoftRender::Simd::Sse2, SoftRender::Simd::Avx2}) {
+        SoftRender render;
+        render.Init(Width, Height, 3);
+        render.SetSimd(simd);
+        render.DrawLines(lines, 4.f); // Wide enough for pixels near the lines to be fully covered
+        const std::vector<float> pixels(render.Pixels(), render.Pixels() + Width * Height);
+
+        auto Pixel = [&](float x, float y) {
+            const int px = static_cast<int>(Width / 2.f + x * Width / 256.f);
+            const int py = static_cast<int>(Height / 2.f - y * Height / 256.f);
+            return pixels[py * Width + px];
+        };
+        EXPECT_FLOAT_EQ(Pixel(0, -20), 1.f);
+        EXPECT_FLOAT_EQ(Pixel(-128, 100), 0.5f);
+        EXPECT_FLOAT_EQ(Pixel(127, 100), 0.5f);
+        EXPECT_FLOAT_EQ(Pixel(50, -50), 1.f);
+        EXPECT_EQ(Pixel(0, 0), 0.f);
+        EXPECT_EQ(Pixel(-50, 100 - 10), 0.f);
+
+        // All instruction sets must produce the same image
+        if (simd == SoftRender::Simd::Scalar)
+            scalarPixels = pixels;
+        EXPECT_EQ(pixels, scalarPixels) << SoftRender::SimdName(render.GetSimd());
+
+        render.Clear();
+        EXPECT_EQ(*std::max_element(render.Pixels(), render.Pixels() + Width * Height), 0.f);
+    }
+}
+
+TEST(SoftCrtRender, GlowDecayAndOverlay) {
+    constexpr int Width = 203;
+    constexpr int Height = 256; // The CRT is 204 rows, centered
+
+    const LineBuffer lines = {{{-100, 0}, {100, 0}, 1.f}};
+
+    std::vector<uint8_t> scalarImage;
+    for (auto simd : {SoftRender::Simd::Scalar, SoftRender::Simd::Sse2, SoftRender::Simd::Avx2}) {
+        SoftCrtRender render;
+        render.Init(Width, Height, 3);
+        render.SetSimd(simd);
+
+        std::vector<uint8_t> image(Width * Height * 3);
+        auto Pixel = [&](int x, int y) { return image[(y * Width + x) * 3]; };
+        // Of the rows around the line, as its coverage may be split between two of them
+        const int lineY = Height / 2;
+        auto LineBrightness = [&] {
+            uint8_t brightness = 0;
+            for (int y = lineY - 2; y <= lineY + 2; ++y)
+                brightness = std::max(brightness, Pixel(Width / 2, y));
+            return brightness;
+        };
+
+        render.Render(0, lines);
+        render.ToRgb8(image.data());
+        EXPECT_GT(LineBrightness(), 100);
+        EXPECT_GT(Pixel(Width / 2, lineY + 4), 0); // Glow
+        EXPECT_EQ(Pixel(Width / 2, lineY + 20), 0);
+        EXPECT_EQ(Pixel(Width / 2, 0), 0); // Outside of the CRT
+
+        // All instruction sets must produce the same image
+        if (simd == SoftRender::Simd::Scalar)
+            scalarImage = image;
+        EXPECT_EQ(image, scalarImage) << SoftRender::SimdName(render.GetSimd());
+
+        // Lines fade out once they're no longer drawn
+        const uint8_t lineBrightness = LineBrightness();
+        render.Render(1.0 / 60, {});
+        render.ToRgb8(image.data());
+        EXPECT_LT(LineBrightness(), lineBrightness);
+        EXPECT_GT(LineBrightness(), 0);
+        for (int i = 0; i < 60; ++i)
+            render.Render(1.0 / 60, {});
+        render.ToRgb8(image.data());
+        EXPECT_EQ(*std::max_element(image.begin(), image.end()), 0);
+
+        // Opaque blue on top, transparent at the bottom
+        const uint8_t overlay[] = {0, 0, 255, 255, 0, 0, 0, 0};
+        render.SetOverlay(overlay, 1, 2);
+        render.Render(0, lines);
+        render.ToRgb8(image.data());
+        EXPECT_EQ(image[2], 255);                            // Top left is blue
+        EXPECT_EQ(image[((Height - 1) * Width) * 3 + 2], 0); // Bottom left isn't covered
+        EXPECT_GT(LineBrightness(), 0);
+        EXPECT_GT(render.StageSeconds(SoftCrtRender::Stage::Composite), 0);
+    }
+}
+
+TEST(LineVertices, QuadsLinesAndPoints) {
+    LineBuffer lines = {
+        {{0, 0}, {10, 0}, 0.5f}, // Horizontal
+        {{5, 5}, {5, 5}, 1.f},   // Dot
+    };
+    // 11 lines in all, so that SIMD batches end with a partial one, some of them short
+    for (int i = 0; i < 9; ++i) {
+        const float f = static_cast<float>(i);
+        lines.PushBack({{f * 10, -f}, {f * 10.2f, 20 - f * 3}, 0.1f * f});
+    }
+
+    auto ToFloats = [](LineVertices::VertexArray array) {
+        const float* begin = &array.vertices->x;
+        return std::vector<float>(begin, begin + array.size * 3);
+    };
+    auto ExpectVertex = [](const LineVertices::Vertex& v, float x, float y, float brightness) {
+        EXPECT_FLOAT_EQ(v.x, x);
+        EXPECT_FLOAT_EQ(v.y, y);
+        EXPECT_FLOAT_EQ(v.brightness, brightness);
+    };
+
+    std::vector<float> scalarQuads, scalarLines, scalarPoints;
+    for (auto layout : {LineBuffer::Layout::Lines, LineBuffer::Layout::Arrays}) {
+        lines.SetLayout(layout);
+        for (auto simd :
+             {SoftRender::Simd::Scalar, SoftRender::Simd::Sse2, SoftRender::Simd::Avx2}) {
+            LineVertices vertices;
+            vertices.SetSimd(simd);
+
+            vertices.BuildQuads(lines, 2.f, 2.f, 3.f);
+            const auto quads = vertices.Quads();
+            ASSERT_EQ(quads.size, lines.Size() * 6);
+            // Horizontal line, 1 to each side of it
+            ExpectVertex(quads.vertices[0], 0, 1, 0.5f);
+            ExpectVertex(quads.vertices[1], 0, -1, 0.5f);
+            ExpectVertex(quads.vertices[2], 20, -1, 0.5f);
+            ExpectVertex(quads.vertices[3], 20, -1, 0.5f);
+            ExpectVertex(quads.vertices[4], 20, 1, 0.5f);
+            ExpectVertex(quads.vertices[5], 0, 1, 0.5f);
+            // Dot, as a square
+            ExpectVertex(quads.vertices[6], 11, 16, 1.f);
+            ExpectVertex(quads.vertices[7], 11, 14, 1.f);
+            ExpectVertex(quads.vertices[8], 9, 14, 1.f);
+            ExpectVertex(quads.vertices[10], 9, 16, 1.f);
+
+            vertices.BuildLinesAndPoints(lines, 2.f, 3.f);
+            const auto lineVertices = vertices.Lines();
+            const auto points = vertices.Points();
+            ASSERT_EQ(points.size, 1u);
+            ASSERT_EQ(lineVertices.size, (lines.Size() - 1) * 2);
+            ExpectVertex(points.vertices[0], 10, 15, 1.f);
+            ExpectVertex(lineVertices.vertices[0], 0, 0, 0.5f);
+            ExpectVertex(lineVertices.vertices[1], 20, 0, 0.5f);
+
+            // All instruction sets and layouts must produce the same vertices
+            if (layout == LineBuffer::Layout::Lines && simd == SoftRender::Simd::Scalar) {
+                scalarQuads = ToFloats(vertices.Quads());
+                scalarLines = ToFloats(lineVertices);
+                scalarPoints = ToFloats(points);
+            }
+            const char* simdName = SoftRender::SimdName(vertices.GetSimd());
+            EXPECT_EQ(ToFloats(vertices.Quads()), scalarQuads) << simdName;
+            EXPECT_EQ(ToFloats(lineVertices), scalarLines) << simdName;
+            EXPECT_EQ(ToFloats(points), scalarPoints) << simdName;
+
+            // Buffers are reused for smaller frames
+            vertices.BuildQuads({}, 2.f, 2.f, 3.f);
+            EXPECT_EQ(vertices.Quads().size, 0u);
+        }
+    }
+}